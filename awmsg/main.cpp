@@ -1,6 +1,7 @@
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -21,10 +22,23 @@ void print_usage() {
               << tab << "[e]xit" << std::endl
               << tab << "[o]utput" << std::endl
               << tab << tab << "- [l]ist" << std::endl
+              << tab << tab << "- [s]tats" << std::endl
               << tab << "[w]orkspace" << std::endl
               << tab << tab << "- [l]ist" << std::endl
+              << tab << "[tr]ace" << std::endl
+              << tab << tab << "- [d]ump" << std::endl
               << tab << "[t]oplevel" << std::endl
-              << tab << tab << "- [l]ist" << std::endl;
+              << tab << tab << "- [l]ist" << std::endl
+              << tab << "[c]lient" << std::endl
+              << tab << tab << "- [l]ist [commits|memory|damage]" << std::endl
+              << tab << "[m]etrics" << std::endl
+              << tab << "[l]og" << std::endl
+              << tab << tab << "- [t]ail [n]" << std::endl
+              << tab << "[b]ench" << std::endl
+              << tab << tab << "- [p]ing" << std::endl
+              << tab << tab << "- [s]tats" << std::endl
+              << tab << tab << "- [t]ile [repeat]" << std::endl
+              << tab << tab << "- [w]orkspace <n>" << std::endl;
 }
 
 int main(int argc, char **argv) {
@@ -57,6 +71,8 @@ int main(int argc, char **argv) {
 
         if (argv[2][0] == 'l')
             message = "output list";
+        else if (argv[2][0] == 's')
+            message = "output stats";
     }
 
     // group workspace
@@ -70,8 +86,20 @@ int main(int argc, char **argv) {
             message = "workspace list";
     }
 
+    // group trace
+    const bool trace = group.rfind("tr", 0) == 0;
+    if (trace) {
+        if (argc == 2) {
+            print_usage();
+            return 1;
+        }
+
+        if (argv[2][0] == 'd')
+            message = "trace dump";
+    }
+
     // group toplevel
-    if (group[0] == 't') {
+    if (group[0] == 't' && !trace) {
         if (argc == 2) {
             print_usage();
             return 1;
@@ -81,6 +109,61 @@ int main(int argc, char **argv) {
             message = "toplevel list";
     }
 
+    // group client
+    if (group[0] == 'c') {
+        if (argc == 2) {
+            print_usage();
+            return 1;
+        }
+
+        if (argv[2][0] == 'l')
+            message = "client list";
+
+        // sort order
+        if (!message.empty() && argc > 3)
+            message += " " + std::string(argv[3]);
+    }
+
+    // group metrics
+    if (group[0] == 'm')
+        message = "metrics";
+
+    // group log
+    if (group[0] == 'l') {
+        if (argc == 2) {
+            print_usage();
+            return 1;
+        }
+
+        if (argv[2][0] == 't')
+            message = "log tail";
+
+        // line count
+        if (!message.empty() && argc > 3)
+            message += " " + std::string(argv[3]);
+    }
+
+    // group bench
+    if (group[0] == 'b') {
+        if (argc == 2) {
+            print_usage();
+            return 1;
+        }
+
+        if (argv[2][0] == 'p')
+            message = "bench ping";
+        else if (argv[2][0] == 's')
+            message = "bench stats";
+        else if (argv[2][0] == 't')
+            message = "bench tile";
+        else if (argv[2][0] == 'w' && argc > 3)
+            message = "bench workspace";
+
+        // argument
+        if (!message.empty() && argc > 3)
+            message += " " + std::string(argv[3]);
+    }
+
     // invalid group or command
     if (message == "") {
         std::string query = argv[1];
@@ -102,7 +185,9 @@ int main(int argc, char **argv) {
     // connect to ipc socket
     sockaddr_un addr{};
     addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, "/tmp/awm.sock", sizeof(addr.sun_path) - 1);
+    const char *path = getenv("AWM_SOCK");
+    strncpy(addr.sun_path, path ? path : "/tmp/awm.sock",
+            sizeof(addr.sun_path) - 1);
 
     if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
         sizeof(struct sockaddr_un))) {
@@ -128,7 +213,10 @@ int main(int argc, char **argv) {
         return 4;
     }
 
-    if (!response.empty()) {
+    // metrics are plain text
+    if (message == "metrics")
+        std::cout << response;
+    else if (!response.empty()) {
         // parse response json
         json response_json = json::parse(response);
 
@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <poll.h>
+#include <string>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <wayland-client.h>
+
+#include "xdg-shell-client-protocol.h"
+
+// synthetic load for benchmarking awm: opens toplevels with shm buffers,
+// commits at a fixed rate, spawns popups and resizes and closes windows on
+// a schedule. prints a json summary on exit
+
+struct Options {
+    int windows{1};
+    double rate{60.0};
+    int popups{0};
+    int popup_interval{100};
+    int resize_interval{0};
+    int close_after{0};
+    int duration{0};
+};
+
+// shm buffer kept mapped and reused once the compositor releases it
+struct Buffer {
+    wl_buffer *buffer{nullptr};
+    uint32_t *data{nullptr};
+    size_t size{0};
+    int32_t width{0}, height{0};
+    bool busy{false};
+
+    // destroyed on release, the window was resized
+    bool stale{false};
+};
+
+struct Window {
+    struct Client *client;
+    wl_surface *surface{nullptr};
+    struct xdg_surface *xdg_surface{nullptr};
+    struct xdg_toplevel *xdg_toplevel{nullptr};
+    std::vector<wl_surface *> popup_surfaces;
+    std::vector<struct xdg_surface *> popup_xdg_surfaces;
+    std::vector<xdg_popup *> popups;
+
+    // buffers of the current size, and of earlier sizes still held by the
+    // compositor
+    std::vector<Buffer *> buffers;
+
+    int32_t width{320}, height{240};
+    bool configured{false};
+    bool closed{false};
+
+    // map latency, from creating the toplevel to its first frame done
+    int64_t created_ns{0};
+    int64_t mapped_ns{0};
+    bool frame_pending{false};
+};
+
+struct Client {
+    Options options;
+    wl_display *display{nullptr};
+    wl_registry *registry{nullptr};
+    wl_compositor *compositor{nullptr};
+    wl_shm *shm{nullptr};
+    xdg_wm_base *wm_base{nullptr};
+
+    // shared by every popup
+    Buffer *popup_buffer{nullptr};
+
+    std::vector<Window *> windows;
+
+    uint64_t commits{0};
+    uint64_t frames{0};
+    uint64_t popups_created{0};
+    uint64_t resizes{0};
+};
+
+static volatile sig_atomic_t running = 1;
+
+// set by SIGUSR1 to close every window now
+static volatile sig_atomic_t close_requested = 0;
+
+// get the monotonic time in nanoseconds
+static int64_t get_time_nsec() {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+static void destroy_buffer(Buffer *buffer) {
+    wl_buffer_destroy(buffer->buffer);
+    munmap(buffer->data, buffer->size);
+    delete buffer;
+}
+
+static const wl_buffer_listener buffer_listener = {
+    .release = [](void *data, [[maybe_unused]] wl_buffer *wl_buffer) {
+        auto *buffer = static_cast<Buffer *>(data);
+        if (buffer->stale)
+            destroy_buffer(buffer);
+        else
+            buffer->busy = false;
+    },
+};
+
+// create a mapped argb buffer, the only time a shm pool is created
+static Buffer *create_buffer(const Client *client, const int32_t width,
+                             const int32_t height) {
+    const int32_t stride = width * 4;
+    const size_t size = static_cast<size_t>(stride) * height;
+
+    const int fd = memfd_create("awm-bench", MFD_CLOEXEC);
+    if (fd == -1 || ftruncate(fd, static_cast<off_t>(size)) == -1) {
+        if (fd != -1)
+            close(fd);
+        return nullptr;
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+    wl_shm_pool *pool =
+        wl_shm_create_pool(client->shm, fd, static_cast<int32_t>(size));
+    auto *buffer = new Buffer();
+    buffer->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride,
+                                               WL_SHM_FORMAT_ARGB8888);
+    buffer->data = static_cast<uint32_t *>(data);
+    buffer->size = size;
+    buffer->width = width;
+    buffer->height = height;
+    wl_buffer_add_listener(buffer->buffer, &buffer_listener, buffer);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    return buffer;
+}
+
+// get a released buffer of the window size, allocating one only on resize
+// or while the compositor holds all of them. returns nullptr if it holds
+// as many as a triple buffered client would have
+static Buffer *next_buffer(Window *window) {
+    // drop buffers of an earlier size, once released
+    auto &buffers = window->buffers;
+    for (auto it = buffers.begin(); it != buffers.end();) {
+        Buffer *buffer = *it;
+        if (buffer->width == window->width &&
+            buffer->height == window->height) {
+            ++it;
+            continue;
+        }
+
+        if (buffer->busy)
+            buffer->stale = true;
+        else
+            destroy_buffer(buffer);
+        it = buffers.erase(it);
+    }
+
+    for (Buffer *buffer : buffers)
+        if (!buffer->busy)
+            return buffer;
+
+    if (buffers.size() >= 3)
+        return nullptr;
+
+    Buffer *buffer =
+        create_buffer(window->client, window->width, window->height);
+    if (buffer)
+        buffers.emplace_back(buffer);
+    return buffer;
+}
+
+static const wl_callback_listener frame_listener = {
+    .done = [](void *data, wl_callback *callback,
+               [[maybe_unused]] uint32_t time) {
+        auto *window = static_cast<Window *>(data);
+        wl_callback_destroy(callback);
+
+        window->frame_pending = false;
+        ++window->client->frames;
+
+        // first frame done, the window is on screen
+        if (!window->mapped_ns)
+            window->mapped_ns = get_time_nsec();
+    },
+};
+
+// redraw a released buffer and commit
+static void commit_window(Window *window) {
+    Client *client = window->client;
+    if (!window->configured || window->closed)
+        return;
+
+    Buffer *buffer = next_buffer(window);
+    if (!buffer)
+        return;
+
+    std::fill_n(buffer->data, buffer->size / 4,
+                0xff000000 | static_cast<uint32_t>(client->commits));
+    buffer->busy = true;
+
+    wl_surface_attach(window->surface, buffer->buffer, 0, 0);
+    wl_surface_damage_buffer(window->surface, 0, 0, window->width,
+                             window->height);
+
+    // one frame callback at a time
+    if (!window->frame_pending) {
+        window->frame_pending = true;
+        wl_callback_add_listener(wl_surface_frame(window->surface),
+                                 &frame_listener, window);
+    }
+
+    wl_surface_commit(window->surface);
+    ++client->commits;
+}
+
+static const xdg_surface_listener xdg_surface_listener = {
+    .configure = [](void *data, xdg_surface *xdg_surface,
+                    const uint32_t serial) {
+        auto *window = static_cast<Window *>(data);
+        xdg_surface_ack_configure(xdg_surface, serial);
+
+        // map on the first configure
+        const bool first = !window->configured;
+        window->configured = true;
+        if (first)
+            commit_window(window);
+    },
+};
+
+static const xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = [](void *data, [[maybe_unused]] xdg_toplevel *xdg_toplevel,
+                    const int32_t width, const int32_t height,
+                    [[maybe_unused]] wl_array *states) {
+        auto *window = static_cast<Window *>(data);
+        if (width > 0 && height > 0) {
+            window->width = width;
+            window->height = height;
+        }
+    },
+    .close = [](void *data, [[maybe_unused]] xdg_toplevel *xdg_toplevel) {
+        static_cast<Window *>(data)->closed = true;
+    },
+    .configure_bounds = []([[maybe_unused]] void *data,
+                           [[maybe_unused]] xdg_toplevel *xdg_toplevel,
+                           [[maybe_unused]] int32_t width,
+                           [[maybe_unused]] int32_t height) {},
+    .wm_capabilities = []([[maybe_unused]] void *data,
+                          [[maybe_unused]] xdg_toplevel *xdg_toplevel,
+                          [[maybe_unused]] wl_array *capabilities) {},
+};
+
+static const xdg_wm_base_listener wm_base_listener = {
+    .ping = []([[maybe_unused]] void *data, xdg_wm_base *wm_base,
+               const uint32_t serial) { xdg_wm_base_pong(wm_base, serial); },
+};
+
+static const wl_registry_listener registry_listener = {
+    .global = [](void *data, wl_registry *registry, const uint32_t name,
+                 const char *interface, const uint32_t version) {
+        auto *client = static_cast<Client *>(data);
+
+        if (!strcmp(interface, wl_compositor_interface.name))
+            client->compositor = static_cast<wl_compositor *>(wl_registry_bind(
+                registry, name, &wl_compositor_interface,
+                std::min(version, 4u)));
+        else if (!strcmp(interface, wl_shm_interface.name))
+            client->shm = static_cast<wl_shm *>(
+                wl_registry_bind(registry, name, &wl_shm_interface, 1));
+        else if (!strcmp(interface, xdg_wm_base_interface.name)) {
+            client->wm_base = static_cast<xdg_wm_base *>(wl_registry_bind(
+                registry, name, &xdg_wm_base_interface, std::min(version, 5u)));
+            xdg_wm_base_add_listener(client->wm_base, &wm_base_listener,
+                                     client);
+        }
+    },
+    .global_remove = []([[maybe_unused]] void *data,
+                        [[maybe_unused]] wl_registry *registry,
+                        [[maybe_unused]] uint32_t name) {},
+};
+
+// open a toplevel, it maps once configured
+static Window *open_window(Client *client, const int index) {
+    auto *window = new Window();
+    window->client = client;
+    window->created_ns = get_time_nsec();
+
+    window->surface = wl_compositor_create_surface(client->compositor);
+    window->xdg_surface =
+        xdg_wm_base_get_xdg_surface(client->wm_base, window->surface);
+    xdg_surface_add_listener(window->xdg_surface, &xdg_surface_listener,
+                             window);
+
+    window->xdg_toplevel = xdg_surface_get_toplevel(window->xdg_surface);
+    xdg_toplevel_add_listener(window->xdg_toplevel, &xdg_toplevel_listener,
+                              window);
+
+    const std::string title = "awm-bench " + std::to_string(index);
+    xdg_toplevel_set_title(window->xdg_toplevel, title.c_str());
+    xdg_toplevel_set_app_id(window->xdg_toplevel, "awm-bench");
+
+    wl_surface_commit(window->surface);
+    return window;
+}
+
+// destroy the popups of a window
+static void close_popups(Window *window) {
+    for (xdg_popup *popup : window->popups)
+        xdg_popup_destroy(popup);
+    for (xdg_surface *xdg_surface : window->popup_xdg_surfaces)
+        xdg_surface_destroy(xdg_surface);
+    for (wl_surface *surface : window->popup_surfaces)
+        wl_surface_destroy(surface);
+
+    window->popups.clear();
+    window->popup_xdg_surfaces.clear();
+    window->popup_surfaces.clear();
+}
+
+static const xdg_popup_listener popup_listener = {
+    .configure = []([[maybe_unused]] void *data,
+                    [[maybe_unused]] xdg_popup *xdg_popup,
+                    [[maybe_unused]] int32_t x, [[maybe_unused]] int32_t y,
+                    [[maybe_unused]] int32_t width,
+                    [[maybe_unused]] int32_t height) {},
+    .popup_done = []([[maybe_unused]] void *data,
+                     [[maybe_unused]] xdg_popup *xdg_popup) {},
+    .repositioned = []([[maybe_unused]] void *data,
+                       [[maybe_unused]] xdg_popup *xdg_popup,
+                       [[maybe_unused]] uint32_t token) {},
+};
+
+static const struct xdg_surface_listener popup_surface_listener = {
+    .configure = [](void *data, xdg_surface *xdg_surface,
+                    const uint32_t serial) {
+        xdg_surface_ack_configure(xdg_surface, serial);
+
+        // map the popup with the shared small buffer
+        auto *surface = static_cast<wl_surface *>(data);
+        auto *client = static_cast<Client *>(wl_surface_get_user_data(surface));
+        if (!client->popup_buffer) {
+            client->popup_buffer = create_buffer(client, 64, 64);
+            if (!client->popup_buffer)
+                return;
+            std::fill_n(client->popup_buffer->data,
+                        client->popup_buffer->size / 4, 0xff808080);
+        }
+
+        wl_surface_attach(surface, client->popup_buffer->buffer, 0, 0);
+        wl_surface_commit(surface);
+    },
+};
+
+// replace the popups of a window with a new batch
+static void popup_storm(Client *client, Window *window) {
+    close_popups(window);
+
+    for (int i = 0; i != client->options.popups; ++i) {
+        xdg_positioner *positioner =
+            xdg_wm_base_create_positioner(client->wm_base);
+        xdg_positioner_set_size(positioner, 64, 64);
+        xdg_positioner_set_anchor_rect(positioner, (i * 16) % window->width,
+                                       (i * 16) % window->height, 1, 1);
+
+        wl_surface *surface = wl_compositor_create_surface(client->compositor);
+        wl_surface_set_user_data(surface, client);
+        xdg_surface *xdg_surface =
+            xdg_wm_base_get_xdg_surface(client->wm_base, surface);
+        xdg_surface_add_listener(xdg_surface, &popup_surface_listener, surface);
+
+        xdg_popup *popup =
+            xdg_surface_get_popup(xdg_surface, window->xdg_surface, positioner);
+        xdg_popup_add_listener(popup, &popup_listener, nullptr);
+        xdg_positioner_destroy(positioner);
+
+        wl_surface_commit(surface);
+
+        window->popup_surfaces.emplace_back(surface);
+        window->popup_xdg_surfaces.emplace_back(xdg_surface);
+        window->popups.emplace_back(popup);
+        ++client->popups_created;
+    }
+}
+
+static void destroy_window(Window *window) {
+    close_popups(window);
+    if (window->xdg_toplevel)
+        xdg_toplevel_destroy(window->xdg_toplevel);
+    if (window->xdg_surface)
+        xdg_surface_destroy(window->xdg_surface);
+    if (window->surface)
+        wl_surface_destroy(window->surface);
+    for (Buffer *buffer : window->buffers)
+        destroy_buffer(buffer);
+    window->buffers.clear();
+
+    window->xdg_toplevel = nullptr;
+    window->xdg_surface = nullptr;
+    window->surface = nullptr;
+    window->closed = true;
+}
+
+// print the run summary as json
+static void print_summary(const Client *client) {
+    std::vector<int64_t> latencies;
+    for (const Window *window : client->windows)
+        if (window->mapped_ns)
+            latencies.emplace_back(window->mapped_ns - window->created_ns);
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&latencies](const size_t p) {
+        return latencies.empty()
+                   ? 0.0
+                   : latencies[(latencies.size() - 1) * p / 100] / 1e6;
+    };
+
+    printf("{\"windows\":%zu,\"mapped\":%zu,\"commits\":%lu,\"frames\":%lu,"
+           "\"popups\":%lu,\"resizes\":%lu,\"map_latency_ms\":{\"p50\":%f,"
+           "\"p90\":%f,\"p99\":%f,\"max\":%f}}\n",
+           client->windows.size(), latencies.size(),
+           static_cast<unsigned long>(client->commits),
+           static_cast<unsigned long>(client->frames),
+           static_cast<unsigned long>(client->popups_created),
+           static_cast<unsigned long>(client->resizes), percentile(50),
+           percentile(90), percentile(99), percentile(100));
+    fflush(stdout);
+}
+
+int main(const int argc, char *argv[]) {
+    Client client;
+    Options &options = client.options;
+
+    const std::string usage =
+        "Usage: %s [-w windows] [-r commit rate] [-p popups per storm]\n"
+        "          [-i popup interval ms] [-z resize interval ms]\n"
+        "          [-x close after ms] [-d duration s]\n"
+        "SIGUSR1 closes every window\n";
+
+    const option long_options[] = {
+        {"windows", required_argument, nullptr, 'w'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"popups", required_argument, nullptr, 'p'},
+        {"popup-interval", required_argument, nullptr, 'i'},
+        {"resize-interval", required_argument, nullptr, 'z'},
+        {"close-after", required_argument, nullptr, 'x'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "w:r:p:i:z:x:d:h", long_options,
+                            nullptr)) != -1) {
+        switch (c) {
+        case 'w':
+            options.windows = std::max(atoi(optarg), 0);
+            break;
+        case 'r':
+            options.rate = atof(optarg);
+            break;
+        case 'p':
+            options.popups = std::max(atoi(optarg), 0);
+            break;
+        case 'i':
+            options.popup_interval = std::max(atoi(optarg), 1);
+            break;
+        case 'z':
+            options.resize_interval = std::max(atoi(optarg), 0);
+            break;
+        case 'x':
+            options.close_after = std::max(atoi(optarg), 0);
+            break;
+        case 'd':
+            options.duration = std::max(atoi(optarg), 0);
+            break;
+        default:
+            printf(usage.c_str(), argv[0]);
+            return 0;
+        }
+    }
+
+    // stop cleanly and report
+    signal(SIGTERM, [](int) { running = 0; });
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGUSR1, [](int) { close_requested = 1; });
+
+    client.display = wl_display_connect(nullptr);
+    if (!client.display) {
+        fprintf(stderr, "failed to connect to the wayland display\n");
+        return 1;
+    }
+
+    client.registry = wl_display_get_registry(client.display);
+    wl_registry_add_listener(client.registry, &registry_listener, &client);
+    wl_display_roundtrip(client.display);
+
+    if (!client.compositor || !client.shm || !client.wm_base) {
+        fprintf(stderr, "missing wl_compositor, wl_shm or xdg_wm_base\n");
+        return 1;
+    }
+
+    for (int i = 0; i != options.windows; ++i)
+        client.windows.emplace_back(open_window(&client, i));
+
+    const int64_t start = get_time_nsec();
+    const int64_t commit_interval =
+        options.rate > 0 ? static_cast<int64_t>(1e9 / options.rate) : 0;
+    int64_t next_commit = start + commit_interval;
+    int64_t next_popups = start + options.popup_interval * 1000000ll;
+    int64_t next_resize = start + options.resize_interval * 1000000ll;
+
+    while (running) {
+        const int64_t now = get_time_nsec();
+
+        // end of the run
+        if (options.duration && now - start >= options.duration * 1000000000ll)
+            break;
+
+        // close every window
+        if (close_requested || (options.close_after &&
+                                now - start >= options.close_after * 1000000ll))
+            for (Window *window : client.windows)
+                if (!window->closed)
+                    destroy_window(window);
+
+        // commit every window
+        if (commit_interval && now >= next_commit) {
+            for (Window *window : client.windows)
+                commit_window(window);
+            next_commit += commit_interval;
+            if (next_commit < now)
+                next_commit = now + commit_interval;
+        }
+
+        // popup storm on the first window
+        if (options.popups && now >= next_popups) {
+            if (!client.windows.empty() && !client.windows[0]->closed &&
+                client.windows[0]->configured)
+                popup_storm(&client, client.windows[0]);
+            next_popups = now + options.popup_interval * 1000000ll;
+        }
+
+        // alternate buffer sizes
+        if (options.resize_interval && now >= next_resize) {
+            for (Window *window : client.windows) {
+                window->width = window->width == 320 ? 640 : 320;
+                window->height = window->height == 240 ? 480 : 240;
+                commit_window(window);
+            }
+            ++client.resizes;
+            next_resize = now + options.resize_interval * 1000000ll;
+        }
+
+        wl_display_flush(client.display);
+
+        // wait for events until the next scheduled action
+        int64_t next = INT64_MAX;
+        if (commit_interval)
+            next = std::min(next, next_commit);
+        if (options.popups)
+            next = std::min(next, next_popups);
+        if (options.resize_interval)
+            next = std::min(next, next_resize);
+        const int timeout =
+            next == INT64_MAX
+                ? 100
+                : static_cast<int>(std::clamp<int64_t>(
+                      (next - get_time_nsec()) / 1000000, 0, 100));
+
+        pollfd pfd{wl_display_get_fd(client.display), POLLIN, 0};
+        while (wl_display_prepare_read(client.display) != 0)
+            wl_display_dispatch_pending(client.display);
+
+        if (poll(&pfd, 1, timeout) > 0)
+            wl_display_read_events(client.display);
+        else
+            wl_display_cancel_read(client.display);
+
+        if (wl_display_dispatch_pending(client.display) == -1) {
+            fprintf(stderr, "wayland connection lost\n");
+            break;
+        }
+    }
+
+    print_summary(&client);
+
+    for (Window *window : client.windows) {
+        destroy_window(window);
+        delete window;
+    }
+    if (client.popup_buffer)
+        destroy_buffer(client.popup_buffer);
+    wl_display_disconnect(client.display);
+}
@@ -0,0 +1,107 @@
+#include "SpatialIndex.h"
+#include <chrono>
+#include <iostream>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+// microbenchmarks of the core layout, directional lookup and focus cycling
+// algorithms at 10 to 10,000 windows, printed as json
+
+struct Node {
+    wl_list link;
+};
+
+// keep the optimizer from discarding results
+static volatile size_t sink;
+
+// run f repeatedly for at least min_ns and return the mean time per call
+template <typename F> static double measure(F f, const int64_t min_ns) {
+    using clock = std::chrono::steady_clock;
+
+    // warm up
+    f();
+
+    size_t iterations = 0;
+    const auto start = clock::now();
+    int64_t elapsed = 0;
+    while (elapsed < min_ns) {
+        f();
+        ++iterations;
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      clock::now() - start)
+                      .count();
+    }
+
+    return static_cast<double>(elapsed) / iterations;
+}
+
+int main(const int argc, char *argv[]) {
+    // minimum time spent on each measurement, in ms
+    const int64_t min_ns = (argc > 1 ? atoi(argv[1]) : 200) * 1000000ll;
+
+    const Box area{0, 0, 3840, 2160};
+    const Direction directions[] = {Direction::Up, Direction::Down,
+                                    Direction::Left, Direction::Right};
+
+    json results = json::array();
+    for (const size_t count : {10, 100, 1000, 10000}) {
+        json result = {{"windows", count}};
+
+        // tiling a workspace
+        result["tile_ns"] = measure(
+            [&]() { sink = tile_grid(area, count).size(); }, min_ns);
+
+        // index the tiled windows
+        const std::vector<Box> cells = tile_grid(area, count);
+        std::vector<int> items(count);
+        SpatialIndex index;
+        for (size_t i = 0; i != count; ++i)
+            index.insert(&items[i], cells[i]);
+
+        // rebuilding the index, as after a retile
+        result["index_rebuild_ns"] = measure(
+            [&]() {
+                SpatialIndex rebuilt;
+                for (size_t i = 0; i != count; ++i)
+                    rebuilt.insert(&items[i], cells[i]);
+                sink = rebuilt.entries.size();
+            },
+            min_ns);
+
+        // directional lookup from every window in every direction, per lookup
+        result["in_direction_ns"] =
+            measure(
+                [&]() {
+                    size_t found = 0;
+                    for (size_t i = 0; i != count; ++i)
+                        for (const Direction direction : directions)
+                            found += index.in_direction(&items[i], direction) !=
+                                     nullptr;
+                    sink = found;
+                },
+                min_ns) /
+            static_cast<double>(count * std::size(directions));
+
+        // cycling focus through every window, per step
+        std::vector<Node> nodes(count);
+        wl_list list;
+        wl_list_init(&list);
+        for (Node &node : nodes)
+            wl_list_insert(list.prev, &node.link);
+
+        const wl_list *current = list.next;
+        result["focus_cycle_ns"] =
+            measure(
+                [&]() {
+                    for (size_t i = 0; i != count; ++i)
+                        current = focus_step(&list, current, true);
+                    sink = reinterpret_cast<size_t>(current);
+                },
+                min_ns) /
+            static_cast<double>(count);
+
+        results.emplace_back(result);
+    }
+
+    std::cout << results.dump(4) << std::endl;
+}
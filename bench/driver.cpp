@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+using json = nlohmann::json;
+
+// runs the synthetic client against a headless awm instance and prints the
+// results as json, exiting non-zero if any stage fails
+
+struct Options {
+    std::string awm{"awm"};
+    std::string client{"awm-bench-client"};
+    std::vector<int> counts{10, 100, 1000};
+    double rate{60.0};
+    int samples{50};
+    int duration{5};
+    std::string mode{"1920x1080@60"};
+
+    // client churn, off unless set
+    int popups{0};
+    int popup_interval{100};
+    int resize_interval{0};
+
+    // delay after the other phases before timing how long closing every
+    // window takes, off unless set
+    int close_after{0};
+};
+
+// get the monotonic time in nanoseconds
+static int64_t get_time_nsec() {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+// send a command to the IPC socket and return the parsed response
+static json request(const std::string &path, const std::string &command) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return nullptr;
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ||
+        write(fd, command.c_str(), command.size()) == -1) {
+        close(fd);
+        return nullptr;
+    }
+
+    std::string response;
+    char buffer[1024];
+    ssize_t len;
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+        response.append(buffer, len);
+    close(fd);
+
+    return json::parse(response, nullptr, false);
+}
+
+// start a process with extra environment, optionally capturing its stdout
+static pid_t spawn(const std::vector<std::string> &args,
+                   const std::vector<std::pair<std::string, std::string>> &env,
+                   int *stdout_fd) {
+    int pipe_fds[2] = {-1, -1};
+    if (stdout_fd && pipe(pipe_fds) == -1)
+        return -1;
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        for (const auto &[key, value] : env)
+            setenv(key.c_str(), value.c_str(), true);
+
+        // keep compositor and client logs out of the results
+        const int null_fd = open("/dev/null", O_WRONLY);
+        dup2(stdout_fd ? pipe_fds[1] : null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+
+        std::vector<char *> argv;
+        for (const std::string &arg : args)
+            argv.emplace_back(const_cast<char *>(arg.c_str()));
+        argv.emplace_back(nullptr);
+
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    if (stdout_fd) {
+        close(pipe_fds[1]);
+        *stdout_fd = pipe_fds[0];
+    }
+    return pid;
+}
+
+// poll a condition until it holds or the timeout passes
+template <typename F> static bool wait_for(F condition, const int timeout_s) {
+    const int64_t deadline = get_time_nsec() + timeout_s * 1000000000ll;
+    while (get_time_nsec() < deadline) {
+        if (condition())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+// summarize samples in microseconds
+static json summarize(std::vector<int64_t> samples) {
+    if (samples.empty())
+        return nullptr;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](const size_t p) {
+        return samples[(samples.size() - 1) * p / 100] / 1e3;
+    };
+
+    return {
+        {"p50", percentile(50)},
+        {"p90", percentile(90)},
+        {"p99", percentile(99)},
+        {"max", percentile(100)},
+        {"samples", samples.size()},
+    };
+}
+
+// parse a comma separated list of window counts
+static std::vector<int> parse_counts(const std::string &list) {
+    std::vector<int> counts;
+    std::stringstream ss(list);
+    std::string token;
+    while (std::getline(ss, token, ','))
+        if (const int count = atoi(token.c_str()); count > 0)
+            counts.emplace_back(count);
+    return counts;
+}
+
+int main(const int argc, char *argv[]) {
+    Options options;
+
+    const std::string usage =
+        "Usage: %s [-a awm path] [-c client path] [-w 10,100,1000]\n"
+        "          [-r commit rate] [-n samples] [-d cpu duration s]\n"
+        "          [-m WxH@Hz] [-p popups per storm] [-i popup interval ms]\n"
+        "          [-z resize interval ms] [-x close after ms]\n";
+
+    const option long_options[] = {
+        {"awm", required_argument, nullptr, 'a'},
+        {"client", required_argument, nullptr, 'c'},
+        {"windows", required_argument, nullptr, 'w'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"samples", required_argument, nullptr, 'n'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"mode", required_argument, nullptr, 'm'},
+        {"popups", required_argument, nullptr, 'p'},
+        {"popup-interval", required_argument, nullptr, 'i'},
+        {"resize-interval", required_argument, nullptr, 'z'},
+        {"close-after", required_argument, nullptr, 'x'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "a:c:w:r:n:d:m:p:i:z:x:h", long_options,
+                            nullptr)) != -1) {
+        switch (c) {
+        case 'a':
+            options.awm = optarg;
+            break;
+        case 'c':
+            options.client = optarg;
+            break;
+        case 'w':
+            options.counts = parse_counts(optarg);
+            break;
+        case 'r':
+            options.rate = atof(optarg);
+            break;
+        case 'n':
+            options.samples = std::max(atoi(optarg), 1);
+            break;
+        case 'd':
+            options.duration = std::max(atoi(optarg), 1);
+            break;
+        case 'm':
+            options.mode = optarg;
+            break;
+        case 'p':
+            options.popups = std::max(atoi(optarg), 0);
+            break;
+        case 'i':
+            options.popup_interval = std::max(atoi(optarg), 1);
+            break;
+        case 'z':
+            options.resize_interval = std::max(atoi(optarg), 0);
+            break;
+        case 'x':
+            options.close_after = std::max(atoi(optarg), 0);
+            break;
+        default:
+            printf(usage.c_str(), argv[0]);
+            return 0;
+        }
+    }
+
+    json results = {
+        {"mode", options.mode},
+        {"rate", options.rate},
+        {"popups", options.popups},
+        {"popup_interval_ms", options.popup_interval},
+        {"resize_interval_ms", options.resize_interval},
+        {"close_after_ms", options.close_after},
+    };
+    auto fail = [&results](const std::string &error) {
+        results["error"] = error;
+        std::cout << results.dump(4) << std::endl;
+        return 1;
+    };
+
+    // headless compositor with its own sockets
+    const std::string ipc_path =
+        "/tmp/awm-bench-driver-" + std::to_string(getpid()) + ".sock";
+    const pid_t awm = spawn({options.awm, "--bench", "--virtual-clock",
+                             "--mode", options.mode, "--socket", ipc_path},
+                            {}, nullptr);
+    if (awm == -1)
+        return fail("failed to start awm");
+
+    const std::string display = "awm-bench-" + std::to_string(awm);
+    auto stop_awm = [&]() {
+        kill(awm, SIGTERM);
+        if (!wait_for([awm]() { return waitpid(awm, nullptr, WNOHANG); }, 5))
+            kill(awm, SIGKILL);
+    };
+
+    if (!wait_for([&]() { return request(ipc_path, "bench ping").is_object(); },
+                  10)) {
+        kill(awm, SIGKILL);
+        return fail("awm did not start");
+    }
+
+    // ipc round trip
+    std::vector<int64_t> ping;
+    for (int i = 0; i != options.samples; ++i) {
+        const int64_t start = get_time_nsec();
+        request(ipc_path, "bench ping");
+        ping.emplace_back(get_time_nsec() - start);
+    }
+    results["ipc_rtt_us"] = summarize(ping);
+
+    for (const int count : options.counts) {
+        json run = {{"windows", count}};
+
+        // open the windows and wait for them to map
+        std::vector<std::string> client_args = {
+            options.client, "--windows", std::to_string(count), "--rate",
+            std::to_string(options.rate)};
+        if (options.popups)
+            client_args.insert(client_args.end(),
+                               {"--popups", std::to_string(options.popups),
+                                "--popup-interval",
+                                std::to_string(options.popup_interval)});
+        if (options.resize_interval)
+            client_args.insert(
+                client_args.end(),
+                {"--resize-interval", std::to_string(options.resize_interval)});
+
+        int client_stdout = -1;
+        const pid_t client = spawn(client_args, {{"WAYLAND_DISPLAY", display}},
+                                   &client_stdout);
+        if (client == -1) {
+            stop_awm();
+            return fail("failed to start the client");
+        }
+
+        const bool mapped = wait_for(
+            [&]() {
+                const json stats = request(ipc_path, "bench stats");
+                return stats.is_object() &&
+                       stats.value("toplevels", 0) >= count;
+            },
+            30);
+        run["mapped"] = mapped;
+
+        if (mapped) {
+            // toplevels present at the start of each phase
+            auto toplevels = [&]() {
+                const json stats = request(ipc_path, "bench stats");
+                return stats.is_object() ? stats.value("toplevels", 0) : -1;
+            };
+
+            // tiling the workspace
+            run["toplevels"]["tile"] = toplevels();
+            std::vector<int64_t> tile;
+            for (int i = 0; i != options.samples; ++i)
+                if (json j = request(ipc_path, "bench tile"); j.is_object())
+                    tile.emplace_back(j.value("ns", int64_t{0}));
+            run["tile_us"] = summarize(tile);
+
+            // switching away from the workspace and back
+            run["toplevels"]["workspace_switch"] = toplevels();
+            std::vector<int64_t> workspace;
+            for (int i = 0; i != options.samples; ++i)
+                for (const char *n : {"1", "0"})
+                    if (json j = request(ipc_path,
+                                         std::string("bench workspace ") + n);
+                        j.is_object())
+                        workspace.emplace_back(j.value("ns", int64_t{0}));
+            run["workspace_switch_us"] = summarize(workspace);
+
+            // compositor cpu time per frame while the client commits
+            run["toplevels"]["cpu"] = toplevels();
+            const json before = request(ipc_path, "bench stats");
+            std::this_thread::sleep_for(std::chrono::seconds(options.duration));
+            const json after = request(ipc_path, "bench stats");
+
+            if (before.is_object() && after.is_object()) {
+                const int64_t cpu_ns = after.value("cpu_ns", int64_t{0}) -
+                                       before.value("cpu_ns", int64_t{0});
+                const int64_t frames = after.value("frames", int64_t{0}) -
+                                       before.value("frames", int64_t{0});
+                run["frames"] = frames;
+                run["cpu_ms"] = cpu_ns / 1e6;
+                run["cpu_per_frame_us"] = frames ? cpu_ns / 1e3 / frames : 0.0;
+            }
+
+            // closing every window, once the other phases are done
+            if (options.close_after) {
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(options.close_after));
+
+                run["toplevels"]["close"] = toplevels();
+                const int64_t start = get_time_nsec();
+                kill(client, SIGUSR1);
+
+                bool closed = false;
+                const int64_t deadline = start + 30000000000ll;
+                while (!(closed = toplevels() == 0) &&
+                       get_time_nsec() < deadline)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+                run["closed"] = closed;
+                if (closed)
+                    run["close_ms"] = (get_time_nsec() - start) / 1e6;
+            }
+        }
+
+        // stop the client and collect its report
+        kill(client, SIGTERM);
+        std::string report;
+        char buffer[1024];
+        ssize_t len;
+        while ((len = read(client_stdout, buffer, sizeof(buffer))) > 0)
+            report.append(buffer, len);
+        close(client_stdout);
+        waitpid(client, nullptr, 0);
+
+        run["client"] = json::parse(report, nullptr, false);
+        results["runs"].emplace_back(run);
+
+        // let the compositor settle after the windows close
+        wait_for(
+            [&]() {
+                const json stats = request(ipc_path, "bench stats");
+                return stats.is_object() && stats.value("toplevels", 0) == 0;
+            },
+            10);
+
+        if (!mapped) {
+            stop_awm();
+            return fail("not all " + std::to_string(count) +
+                        " windows mapped");
+        }
+    }
+
+    stop_awm();
+    std::cout << results.dump(4) << std::endl;
+}
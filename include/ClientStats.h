@@ -0,0 +1,64 @@
+#include "wlr.h"
+#include <string>
+#include <unordered_map>
+
+// a surface counted towards its client
+struct ClientSurface {
+    wl_list link;
+    struct ClientStats *stats;
+    wlr_surface *surface;
+
+    wl_listener commit;
+    wl_listener destroy;
+
+    // size of the attached buffer
+    uint64_t buffer_bytes{0};
+
+    ClientSurface(ClientStats *stats, wlr_surface *surface);
+    ~ClientSurface();
+};
+
+// resource usage of one client
+struct ClientStats {
+    struct ClientTracker *tracker;
+    wl_client *client;
+    pid_t pid{0};
+    wl_listener destroy;
+
+    wl_list surfaces;
+
+    uint64_t commits{0};
+    uint64_t damage_px{0};
+
+    // rates over the last full second
+    int64_t window_start_ns;
+    uint64_t window_commits{0};
+    uint64_t window_damage_px{0};
+    double commit_rate{0};
+    double damage_rate{0};
+
+    // time from sending a configure to the commit applying it
+    uint64_t configures{0};
+    int64_t configure_total_ns{0};
+    int64_t configure_max_ns{0};
+
+    ClientStats(ClientTracker *tracker, wl_client *client);
+    ~ClientStats();
+
+    void record_commit(uint64_t damage_px);
+    void record_configure(int64_t ns);
+    void update_rates(int64_t now);
+    uint64_t buffer_bytes() const;
+};
+
+struct ClientTracker {
+    struct Server *server;
+    wl_listener new_surface;
+    std::unordered_map<wl_client *, ClientStats *> clients;
+
+    explicit ClientTracker(Server *server);
+    ~ClientTracker();
+
+    ClientStats *get(wl_client *client);
+    std::string list(const std::string &sort);
+};
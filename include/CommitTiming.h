@@ -0,0 +1,41 @@
+#include "wlr.h"
+#include <deque>
+
+struct CommitTimer {
+    wl_list link;
+    struct CommitTimingManager *manager;
+    wl_resource *resource;
+    wlr_surface *surface;
+
+    wl_listener client_commit;
+    wl_listener surface_destroy;
+
+    // target presentation time for the next commit, 0 if unset
+    int64_t timestamp_ns{0};
+
+    // locked commits and their target presentation times, in order
+    std::deque<std::pair<uint32_t, int64_t>> pending;
+
+    // wakes the surface's outputs shortly before the first target
+    wl_event_source *timer;
+
+    CommitTimer(CommitTimingManager *manager, wl_resource *resource,
+                wlr_surface *surface);
+    ~CommitTimer();
+
+    bool on_output(const struct Output *output) const;
+    void release(int64_t present_ns);
+    void arm() const;
+    void release_surface();
+};
+
+struct CommitTimingManager {
+    struct Server *server;
+    wl_global *global;
+    wl_list timers;
+
+    CommitTimingManager(Server *server);
+    ~CommitTimingManager();
+
+    void output_rendering(const Output *output, int64_t present_ns) const;
+};
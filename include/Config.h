@@ -3,6 +3,7 @@
 #include "wlr.h"
 #include <filesystem>
 #include <libinput.h>
+#include <optional>
 #include <vector>
 
 struct Bind {
@@ -24,9 +25,26 @@ struct OutputConfig {
     double scale{1.0};
     bool adaptive_sync{false};
 
+    // enable adaptive sync only while a game or video is fullscreen
+    bool adaptive_sync_auto{false};
+
+    // refresh rate used while no game or video is fullscreen, 0 to disable
+    double desktop_refresh{0.0};
+
+    // refresh rate used after the output is idle, 0 to disable
+    double idle_refresh{0.0};
+
+    // frame callback rate caps, 0 to use the global caps
+    int64_t unfocused_fps{0};
+    int64_t background_fps{0};
+
+    // allow fullscreen toplevels to tear
+    bool allow_tearing{false};
+
     OutputConfig() = default;
 
     explicit OutputConfig(const wlr_output_configuration_head_v1 *config_head) {
+        name = config_head->state.output->name;
         enabled = config_head->state.enabled;
 
         if (config_head->state.mode) {
@@ -47,6 +65,25 @@ struct OutputConfig {
     }
 };
 
+struct WindowRule {
+    // empty fields match any window
+    std::string app_id;
+    std::string title;
+
+    // frame callback rate cap, 0 for uncapped
+    int64_t max_fps{0};
+
+    // time in ms the window needs to render before the next output render,
+    // frame done is delayed to leave it just that long. 0 disables, -1
+    // measures it from the window's commit latency
+    int64_t max_render_time{0};
+
+    // force tearing on or off when fullscreen, unset follows the client hint
+    std::optional<bool> tearing;
+
+    bool matches(const std::string &app_id, const std::string &title) const;
+};
+
 struct Config {
     std::string path;
     std::filesystem::file_time_type last_write_time;
@@ -57,6 +94,67 @@ struct Config {
     std::vector<std::pair<std::string, std::string>> startup_env;
     std::vector<std::pair<Bind, std::string>> commands;
     bool ipc{true};
+    std::string ipc_socket{"/tmp/awm.sock"};
+
+    // headless benchmark mode, set from the command line
+    struct {
+        bool enabled{false};
+        int outputs{1};
+        int32_t width{1920}, height{1080};
+        double refresh{60.0};
+
+        // stamp presentation with a clock advancing one refresh per frame
+        bool virtual_clock{false};
+    } bench;
+
+    // input recording and replay, set from the command line
+    struct {
+        std::string record;
+        std::string replay;
+        double speed{1.0};
+    } input;
+
+    // frame callback rate caps, 0 for uncapped
+    struct {
+        int64_t unfocused{0};
+        int64_t background{0};
+    } frame_rate;
+
+    // frame scheduling
+    struct {
+        // delay rendering until just before the predicted vblank
+        bool schedule_frames{false};
+
+        // time left between the predicted render end and vblank, in ms
+        int64_t safety_margin{1};
+
+        // seconds without input or damage before outputs use idle_refresh
+        int64_t idle_timeout{30};
+    } render;
+
+    // log level and file, stderr if empty, read at startup
+    struct {
+        std::string level;
+        std::string file;
+    } log;
+
+    // event loop stall watchdog
+    struct {
+        bool enabled{true};
+
+        // dispatch duration reported as a stall, in ms
+        int64_t threshold{50};
+
+        // where stall diagnostics are written
+        std::string directory{"/tmp"};
+
+        // seconds between written reports, and the most written per run
+        int64_t cooldown{60};
+        int64_t max_reports{10};
+    } watchdog;
+
+    // per-window rules, later matches take precedence
+    std::vector<WindowRule> rules;
 
     // keyboard
     std::string keyboard_layout{"us"};
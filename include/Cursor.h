@@ -20,6 +20,11 @@ struct Cursor {
     wlr_box grab_geobox;
     uint32_t resize_edges;
 
+    // source of a move grab, cached so motion events avoid lookups
+    struct Workspace *grab_workspace{nullptr};
+    struct Output *grab_output{nullptr};
+    wlr_box grab_output_box{};
+
     wl_listener motion;
     wl_listener motion_absolute;
     wl_listener button;
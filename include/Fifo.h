@@ -0,0 +1,42 @@
+#include "wlr.h"
+#include <deque>
+
+struct Fifo {
+    wl_list link;
+    struct FifoManager *manager;
+    wl_resource *resource;
+    wlr_surface *surface;
+
+    wl_listener client_commit;
+    wl_listener surface_destroy;
+
+    // requests for the next commit
+    bool set_barrier{false};
+    bool wait_barrier{false};
+
+    // barrier set by the last applied commit, cleared when it is latched
+    bool barrier{false};
+
+    // locked commits waiting for the barrier and whether they set a new one
+    std::deque<std::pair<uint32_t, bool>> waiting;
+
+    Fifo(FifoManager *manager, wl_resource *resource, wlr_surface *surface);
+    ~Fifo();
+
+    bool visible() const;
+    bool on_output(const struct Output *output) const;
+    void advance();
+    void schedule_frame() const;
+    void release_surface();
+};
+
+struct FifoManager {
+    struct Server *server;
+    wl_global *global;
+    wl_list fifos;
+
+    FifoManager(Server *server);
+    ~FifoManager();
+
+    void output_rendered(const Output *output) const;
+};
@@ -1,5 +1,10 @@
 #include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <thread>
@@ -9,12 +14,22 @@ struct IPC {
     struct Server *server;
     int fd;
     sockaddr_un addr{};
-    std::string path{"/tmp/awm.sock"};
+    std::string path;
     std::atomic<bool> running{true};
     std::thread thread;
 
+    // commands that touch compositor state run on the event loop
+    int wake_fd{-1};
+    struct wl_event_source *wake_source{nullptr};
+    std::mutex tasks_mutex;
+    std::deque<std::packaged_task<std::string()>> tasks;
+
     IPC(Server *server);
+    ~IPC();
 
     std::string run(std::string command);
+    std::string run_bench(const std::string &command, std::stringstream &ss);
+    std::string run_on_loop(std::function<std::string()> task);
+    void run_tasks();
     void stop();
 };
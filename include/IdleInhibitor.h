@@ -0,0 +1,13 @@
+#include "wlr.h"
+
+struct IdleInhibitor {
+    wl_list link;
+    struct Server *server;
+    wlr_idle_inhibitor_v1 *inhibitor;
+    wl_listener destroy;
+
+    IdleInhibitor(Server *server, wlr_idle_inhibitor_v1 *inhibitor);
+    ~IdleInhibitor();
+
+    bool visible() const;
+};
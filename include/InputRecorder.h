@@ -0,0 +1,48 @@
+#include "wlr.h"
+#include <cstdio>
+#include <string>
+
+// one recorded input event, written to the recording as is
+struct RecordedEvent {
+    enum Type : uint8_t {
+        KEY,
+        MOTION,
+        MOTION_ABSOLUTE,
+        BUTTON,
+        AXIS,
+    };
+
+    // time since the first recorded event
+    int64_t time_ns;
+
+    Type type;
+    uint8_t state;     // key and button state, axis source
+    uint8_t direction; // axis relative direction
+    uint8_t reserved;
+    uint32_t code; // keycode, button or axis orientation
+
+    // motion deltas, unaccelerated deltas, absolute position or axis deltas
+    float values[4];
+};
+
+static_assert(sizeof(RecordedEvent) == 32);
+
+// header of a recording file
+inline constexpr char recording_magic[8] = {'A', 'W', 'M', 'R',
+                                            'E', 'C', '0', '1'};
+
+struct InputRecorder {
+    FILE *file;
+    int64_t start_ns{0};
+    uint64_t events{0};
+
+    explicit InputRecorder(const std::string &path);
+    ~InputRecorder();
+
+    void record(RecordedEvent event);
+    void key(const wlr_keyboard_key_event *event);
+    void motion(const wlr_pointer_motion_event *event);
+    void motion_absolute(const wlr_pointer_motion_absolute_event *event);
+    void button(const wlr_pointer_button_event *event);
+    void axis(const wlr_pointer_axis_event *event);
+};
@@ -0,0 +1,67 @@
+#include "InputRecorder.h"
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// an injected event waiting for the frame showing its effect
+struct PendingInput {
+    int64_t injected_ns;
+    RecordedEvent::Type type;
+
+    // root of the surface with keyboard or pointer focus when injected
+    wlr_surface *target;
+
+    // first commit of the target after injection, and the outputs showing it
+    int64_t committed_ns{0};
+    std::vector<wlr_output *> outputs;
+};
+
+// watches the target of pending events for its next commit
+struct ReplayTarget {
+    struct InputReplay *replay;
+    wlr_surface *surface;
+
+    wl_listener commit;
+    wl_listener destroy;
+
+    ReplayTarget(InputReplay *replay, wlr_surface *surface);
+    ~ReplayTarget();
+};
+
+struct InputReplay {
+    struct Server *server;
+    std::string path;
+    double speed;
+
+    std::vector<RecordedEvent> events;
+    size_t next{0};
+    int64_t start_ns{0};
+    wl_event_source *timer;
+
+    // virtual devices the recording is injected through
+    wlr_keyboard keyboard{};
+    wlr_pointer pointer{};
+
+    std::deque<PendingInput> pending;
+    std::unordered_map<const wlr_surface *, ReplayTarget *> targets;
+    std::vector<int64_t> latencies[RecordedEvent::AXIS + 1];
+    uint64_t unresolved{0};
+
+    // events injected with no focused surface to show their effect
+    uint64_t untargeted{0};
+    bool finished{false};
+
+    InputReplay(Server *server, const std::string &path, double speed);
+    ~InputReplay();
+
+    bool load();
+    void start();
+    void inject_due();
+    void inject(const RecordedEvent &event);
+    void surface_committed(wlr_surface *surface);
+    void surface_destroyed(const wlr_surface *surface);
+    void frame_presented(const wlr_output *output, int64_t render_start_ns,
+                         int64_t present_ns);
+    void expire(int64_t now);
+    void report();
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <wayland-util.h>
+
+// pure geometry, layout and focus algorithms shared by the compositor and the
+// core microbenchmarks, free of wlroots
+
+// rectangle in layout coordinates, laid out like wlr_box
+struct Box {
+    int x{0}, y{0};
+    int width{0}, height{0};
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    int center_x() const { return x + width / 2; }
+    int center_y() const { return y + height / 2; }
+};
+
+// directions, with the values of wlr_direction
+enum class Direction {
+    Up = 1 << 0,
+    Down = 1 << 1,
+    Left = 1 << 2,
+    Right = 1 << 3,
+};
+
+bool box_contains(const Box &outer, const Box &inner);
+
+std::vector<Box> tile_grid(const Box &area, size_t count);
+
+wl_list *focus_step(const wl_list *list, const wl_list *current, bool forward);
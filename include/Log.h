@@ -0,0 +1,54 @@
+#include "wlr.h"
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// one formatted log line waiting to be written
+struct LogSlot {
+    std::atomic<uint64_t> seq;
+    int64_t time_ns;
+    wlr_log_importance importance;
+    uint32_t truncated;
+    char text[248];
+};
+
+// wlr_log callback writing into a bounded ring from any thread, a background
+// thread writes the lines out and keeps the latest for `awmsg log tail`.
+// errors are written out by the thread logging them, and the ring is written
+// out on fatal signals
+struct LogSink {
+    static LogSink *instance;
+    static constexpr size_t size = 4096;
+    static constexpr size_t history_size = 1000;
+
+    std::array<LogSlot, size> slots;
+    std::atomic<uint64_t> write_index{0};
+    uint64_t read_index{0};
+    std::atomic<uint64_t> dropped{0};
+    int64_t start_ns;
+
+    wlr_log_importance level;
+    FILE *file{stderr};
+
+    std::mutex history_mutex;
+    std::deque<std::string> history;
+
+    std::atomic<bool> running{true};
+    std::thread thread;
+
+    explicit LogSink(wlr_log_importance level);
+    ~LogSink();
+
+    void set_level(wlr_log_importance level);
+    bool open(const std::string &path);
+    void push(wlr_log_importance importance, const char *fmt, va_list args);
+    void flush();
+    void flush_fatal();
+    std::vector<std::string> tail(size_t count);
+};
+
+bool parse_log_level(const std::string &name, wlr_log_importance *level);
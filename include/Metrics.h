@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// cumulative histogram of durations, safe to update from any thread
+struct Histogram {
+    // bucket upper bounds in seconds
+    std::vector<double> bounds;
+    std::vector<std::atomic<uint64_t>> buckets;
+    std::atomic<uint64_t> count{0};
+    std::atomic<int64_t> sum_ns{0};
+
+    Histogram(std::initializer_list<double> bounds);
+
+    void observe(int64_t ns);
+    void expose(std::string &out, const std::string &name,
+                const std::string &labels) const;
+};
+
+// compositor wide counters, served in prometheus text format
+struct Metrics {
+    std::atomic<uint64_t> key_events{0};
+    std::atomic<uint64_t> spawned_processes{0};
+    std::atomic<uint64_t> config_reloads{0};
+    std::atomic<uint64_t> ipc_requests{0};
+    Histogram ipc_duration{0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1};
+
+    std::string expose(const struct Server *server) const;
+};
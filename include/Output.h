@@ -1,10 +1,28 @@
+#include "Metrics.h"
 #include "wlr.h"
+#include <array>
+#include <unordered_map>
+
+struct FrameStats {
+    // scene commit duration
+    int64_t commit_ns;
+
+    // presentation time, 0 if the frame was discarded
+    int64_t present_ns;
+
+    // refresh interval at presentation, 0 if unknown
+    int64_t refresh_ns;
+
+    // vblanks between the expected and actual presentation
+    uint32_t missed;
+};
 
 struct Output {
     struct wl_list link;
     struct Server *server;
     struct wlr_output *wlr_output;
     struct wl_listener frame;
+    struct wl_listener present;
     struct wl_listener request_state;
     struct wl_listener destroy;
 
@@ -27,14 +45,121 @@ struct Output {
     wlr_session_lock_surface_v1 *lock_surface{nullptr};
     wl_listener destroy_lock_surface;
 
+    // frame callback rate caps, 0 to use the global caps
+    struct {
+        int64_t unfocused{0};
+        int64_t background{0};
+    } frame_rate;
+
+    // allow fullscreen toplevels to tear
+    bool allow_tearing{false};
+
+    // last applied config
+    OutputConfig config;
+
+    // a game or video is fullscreen, as last applied by the content policy
+    bool content_dynamic{false};
+    bool content_policy_applied{false};
+
+    // idle refresh downshift
+    wl_event_source *idle_timer{nullptr};
+    bool idle_timer_armed{false};
+    bool idle_downshifted{false};
+    int64_t last_activity_ns{0};
+    int64_t idle_since_ns{0};
+    int64_t idle_grace_ns{0};
+    int64_t idle_backoff{1};
+    wlr_output_mode *idle_saved_mode{nullptr};
+    int32_t idle_saved_refresh{0};
+
+    // mode restored when powering the output back on
+    wlr_output_mode *power_saved_mode{nullptr};
+    int32_t power_saved_width{0}, power_saved_height{0};
+    int32_t power_saved_refresh{0};
+
+    // last frame done sent to each surface, in nanoseconds
+    std::unordered_map<wlr_surface *, int64_t> frame_done_times;
+    wl_event_source *frame_done_timer{nullptr};
+
+    // delayed render for frame scheduling
+    wl_event_source *render_timer{nullptr};
+    bool render_pending{false};
+
+    // time of the last frame event and how long its render was delayed
+    int64_t last_frame_ns{0};
+    int64_t render_delay_ns{0};
+
+    // recent scene commit durations, in nanoseconds
+    std::array<int64_t, 64> commit_times{};
+    size_t commit_times_count{0};
+    size_t commit_times_next{0};
+
+    // all scene commit durations since the output was added
+    Histogram commit_histogram{0.0005, 0.001, 0.002, 0.004, 0.008, 0.016,
+                               0.033};
+
+    // statistics of recent rendered frames
+    std::array<FrameStats, 256> frame_stats{};
+    size_t frame_stats_count{0};
+    size_t frame_stats_next{0};
+    uint64_t frames_presented{0};
+    uint64_t frames_discarded{0};
+    uint64_t frames_missed{0};
+    uint64_t frames_empty{0};
+
+    // rendered commit awaiting presentation
+    bool commit_pending{false};
+    uint32_t commit_seq{0};
+    int64_t commit_ns{0};
+    int64_t commit_end_ns{0};
+
+    // last presentation
+    timespec last_present{};
+    int64_t last_present_ns{0};
+
+    // benchmark virtual clock, advancing exactly one refresh per frame
+    wl_event_source *virtual_timer{nullptr};
+    int64_t virtual_vblank_ns{0};
+
     Output(struct Server *server, struct wlr_output *wlr_output);
     ~Output();
 
     void arrange();
     void arrange_layers();
 
+    void render();
+    bool commit_scene(bool tearing);
+    bool allows_tearing() const;
+    void schedule_render();
+    void virtual_frame();
+    void schedule_virtual_frame() const;
+    int64_t virtual_refresh_ns() const;
+    int64_t predicted_render_time() const;
+    int64_t predicted_present_ns() const;
+    int64_t frame_done_delay(const struct Toplevel *toplevel,
+                             int64_t now_ns) const;
+    void record_present(const wlr_output_event_present *event);
+    void send_frame_done(const timespec *when);
+    bool frame_done_due(const wlr_scene_buffer *buffer, wlr_surface *surface,
+                        int64_t now_ns, int64_t *due_ns) const;
+    void send_surface_frame_done(const wlr_scene_buffer *buffer,
+                                 wlr_surface *surface, const timespec *when,
+                                 int64_t now_ns);
+    int64_t frame_rate_cap(const wlr_scene_node *node) const;
+
+    struct Toplevel *update_fullscreen();
+    void update_content_policy();
+    void notify_activity();
+    void check_idle();
+    bool set_idle_refresh(bool idle);
+    bool set_power(bool on);
+
     void update_position();
+    void build_state(const OutputConfig *config, wlr_output_state *state) const;
+    void config_applied(const OutputConfig *config);
     bool apply_config(const OutputConfig *config, bool test_only);
+    wlr_output_mode *find_mode(int32_t width, int32_t height,
+                               double refresh) const;
 
     static void arrange_layer_surface(const wlr_box *full_area,
                                       wlr_box *usable_area,
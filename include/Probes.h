@@ -0,0 +1,8 @@
+// static tracepoints for bpftrace and perf, compiled out unless awm is built
+// with -Dusdt=true. list them with `bpftrace -l 'usdt:./awm:awm:*'`
+#ifdef USDT
+#include <sys/sdt.h>
+#define AWM_PROBE(name, ...) STAP_PROBEV(awm, name, __VA_ARGS__)
+#else
+#define AWM_PROBE(name, ...)
+#endif
@@ -5,15 +5,25 @@
 #include <thread>
 #include <unistd.h>
 
+#include "ClientStats.h"
+#include "CommitTiming.h"
+#include "Fifo.h"
 #include "IPC.h"
+#include "IdleInhibitor.h"
+#include "InputReplay.h"
 #include "Keyboard.h"
 #include "LayerSurface.h"
+#include "Log.h"
 #include "Output.h"
 #include "OutputManager.h"
 #include "PointerConstraint.h"
+#include "Probes.h"
 #include "Popup.h"
 #include "SessionLock.h"
 #include "Toplevel.h"
+#include "Trace.h"
+#include "Watchdog.h"
+#include "ToplevelIndex.h"
 #include "Workspace.h"
 
 struct Server {
@@ -51,7 +61,7 @@ struct Server {
 
     wlr_relative_pointer_manager_v1 *wlr_relative_pointer_manager;
 
-    Cursor *cursor;
+    Cursor *cursor{nullptr};
 
     wlr_seat *seat;
     wl_listener new_input;
@@ -62,6 +72,8 @@ struct Server {
 
     Toplevel *grabbed_toplevel;
 
+    ToplevelIndex *toplevel_index;
+
     OutputManager *output_manager;
 
     struct {
@@ -101,6 +113,19 @@ struct Server {
     wlr_fractional_scale_manager_v1 *wlr_fractional_scale_manager;
     wlr_alpha_modifier_v1 *wlr_alpha_modifier;
     wlr_single_pixel_buffer_manager_v1 *wlr_single_pixel_buffer_manager;
+    wlr_tearing_control_manager_v1 *wlr_tearing_control_manager;
+    wlr_content_type_manager_v1 *wlr_content_type_manager;
+    FifoManager *fifo_manager;
+    CommitTimingManager *commit_timing_manager;
+    ClientTracker *client_tracker;
+
+    wlr_idle_notifier_v1 *wlr_idle_notifier;
+    wlr_idle_inhibit_manager_v1 *wlr_idle_inhibit_manager;
+    wl_listener new_idle_inhibitor;
+    wl_list idle_inhibitors;
+
+    wlr_output_power_manager_v1 *wlr_output_power_manager;
+    wl_listener set_output_power_mode;
 
 #ifdef XWAYLAND
     wlr_xwayland *xwayland;
@@ -113,6 +138,15 @@ struct Server {
     std::atomic<bool> running{true};
 
     IPC *ipc{nullptr};
+    Watchdog *watchdog{nullptr};
+
+    // counters are bumped from const paths and other threads
+    mutable Metrics metrics;
+
+    InputRecorder *input_recorder{nullptr};
+    InputReplay *input_replay{nullptr};
+
+    wl_event_source *visibility_idle{nullptr};
 
     Server(Config *config);
     ~Server();
@@ -131,6 +165,13 @@ struct Server {
                                    double *sx, double *sy);
 
     Workspace *get_workspace(Toplevel *toplevel) const;
+    void focus_toplevel(Toplevel *toplevel) const;
 
     Toplevel *get_toplevel(wlr_surface *surface) const;
+    Toplevel *toplevel_for_node(const wlr_scene_node *node) const;
+
+    void notify_activity() const;
+    bool records(const wlr_input_device *device) const;
+    void schedule_visibility();
+    void update_visibility();
 };
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Layout.h"
+#include <map>
+#include <unordered_map>
+
+// index of boxes keyed on their center along both axes, answering nearest
+// neighbour queries in a direction. the axes are indexed separately, so a
+// query is logarithmic to find its start but then linear in the items within
+// reach along the direction, not a true 2-d search
+struct SpatialIndex {
+    struct Entry {
+        Box box;
+        std::multimap<int, void *>::iterator x, y;
+    };
+
+    std::unordered_map<const void *, Entry> entries;
+    std::multimap<int, void *> by_x;
+    std::multimap<int, void *> by_y;
+
+    void insert(void *item, const Box &box);
+    bool update(void *item, const Box &box);
+    void remove(const void *item);
+    bool contains(const void *item) const;
+
+    void *in_direction(const void *from, Direction direction) const;
+};
@@ -1,5 +1,10 @@
 #include "Cursor.h"
 
+struct SnapshotBuffer {
+    wlr_scene_buffer *buffer;
+    wlr_box box;
+};
+
 struct Toplevel {
     wl_list link;
     Server *server;
@@ -49,10 +54,40 @@ struct Toplevel {
     wl_listener handle_destroy;
 
     bool hidden{false};
+    bool minimized{false};
+    bool suspended{false};
+    bool covered{false};
+    bool last_opaque{false};
+    wp_content_type_v1_type last_content_type{WP_CONTENT_TYPE_V1_TYPE_NONE};
+
+    // frame callback rate cap from window rules, 0 for uncapped
+    int64_t max_fps{0};
+
+    // delayed frame done, see WindowRule::max_render_time
+    int64_t max_render_time{0};
+    wl_event_source *frame_done_timer{nullptr};
+    int64_t frame_done_ns{0};
+    int64_t commit_latency_ns{0};
+
+    // tearing override from window rules
+    std::optional<bool> tearing;
 
     wlr_box geometry{};
     wlr_box saved_geometry{};
 
+    // last frame shown scaled to the new geometry until the client commits
+    // a buffer for the latest configure
+    wlr_scene_tree *snapshot{nullptr};
+    wlr_scene_node *snapshot_live{nullptr};
+    std::vector<SnapshotBuffer> snapshot_buffers;
+    wlr_box snapshot_box{};
+    uint32_t snapshot_serial{0};
+    wl_event_source *snapshot_timer{nullptr};
+    uint32_t configure_serial{0};
+
+    // when the oldest configure the client has not applied was sent
+    int64_t configure_sent_ns{0};
+
     Toplevel(Server *server, wlr_xdg_toplevel *wlr_xdg_toplevel);
     ~Toplevel();
 
@@ -66,12 +101,25 @@ struct Toplevel {
     void create_handle();
 
     std::string title() const;
-    void focus() const;
+    std::string app_id() const;
+    void apply_rules();
+    void schedule_frame_done(int64_t delay_ms);
+    void send_frame_done();
+    void record_commit();
+    wlr_surface *get_surface() const;
+    void focus();
     void begin_interactive(CursorMode mode, uint32_t edges);
+    void update_scale(const Output *output) const;
     void set_position_size(double x, double y, int width, int height);
     void set_position_size(const wlr_box &geometry);
     wlr_box get_geometry();
     void set_hidden(bool hidden);
+    void set_minimized(bool minimized);
+    void set_suspended(bool suspended);
+    void set_covered(bool covered);
+    void update_enabled();
+    void update_content_state();
+    bool opaque() const;
     bool fullscreen() const;
     bool maximized() const;
     void set_fullscreen(bool fullscreen);
@@ -81,5 +129,9 @@ struct Toplevel {
     void save_geometry();
     void close() const;
 
+    void create_snapshot();
+    void update_snapshot();
+    void destroy_snapshot();
+
     void update_foreign_toplevel() const;
 };
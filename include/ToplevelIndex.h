@@ -0,0 +1,19 @@
+#include "SpatialIndex.h"
+#include "wlr.h"
+
+// spatial index of the geometry of every visible toplevel on every output,
+// keyed on the center of each toplevel along both axes
+struct ToplevelIndex {
+    SpatialIndex index;
+
+    ToplevelIndex() = default;
+    ~ToplevelIndex() = default;
+
+    void insert(struct Toplevel *toplevel);
+    void update(Toplevel *toplevel);
+    void remove(const Toplevel *toplevel);
+    bool contains(const Toplevel *toplevel) const;
+
+    Toplevel *in_direction(const Toplevel *from,
+                           wlr_direction direction) const;
+};
@@ -0,0 +1,46 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// a completed span, names are string literals
+struct TraceEvent {
+    const char *name;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+// ring of the latest spans of one thread, written only by that thread and
+// read by the dump without locking
+struct TraceRing {
+    static constexpr size_t size = 8192;
+
+    std::array<TraceEvent, size> events{};
+    std::atomic<uint64_t> head{0};
+    int tid;
+
+    // innermost open span, read by the watchdog
+    std::atomic<const char *> current{nullptr};
+
+    explicit TraceRing(int tid) : tid(tid) {}
+
+    void push(const TraceEvent &event);
+};
+
+TraceRing *trace_thread_ring();
+void trace_record(const char *name, int64_t start_ns, int64_t end_ns);
+std::string trace_dump();
+
+// records the time between its construction and destruction
+struct TraceSpan {
+    const char *name;
+    int64_t start_ns;
+    TraceRing *ring;
+    const char *parent;
+
+    explicit TraceSpan(const char *name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+};
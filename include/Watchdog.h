@@ -0,0 +1,37 @@
+#include <atomic>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+// watches the event loop from its own thread and writes diagnostics when a
+// dispatch takes longer than the configured threshold
+struct Watchdog {
+    struct Server *server;
+    int64_t threshold_ns;
+    std::string directory;
+
+    // reports are written at most once per cooldown, up to max_reports
+    int64_t cooldown_ns;
+    int64_t max_reports;
+
+    // when the current dispatch started, 0 while waiting for events
+    std::atomic<int64_t> busy_since_ns{0};
+    std::atomic<uint64_t> dispatches{0};
+    std::atomic<bool> running{true};
+
+    // wakes the event loop when stopping
+    int wake_fd{-1};
+    struct wl_event_source *wake_source{nullptr};
+
+    pthread_t main_thread;
+    struct TraceRing *main_ring;
+    std::thread thread;
+
+    explicit Watchdog(Server *server);
+    ~Watchdog();
+
+    void run();
+    void stop();
+    void watch();
+    void report(int64_t stalled_ns, uint64_t suppressed) const;
+};
@@ -15,8 +15,9 @@ struct Workspace {
     void close_active();
     bool contains(const Toplevel *toplevel) const;
     bool move_to(Toplevel *toplevel, Workspace *workspace);
-    void swap(Toplevel *other) const;
+    void swap(Toplevel *other);
     Toplevel *in_direction(wlr_direction direction) const;
+    Toplevel *fullscreen_toplevel() const;
     void set_hidden(bool hidden) const;
     void focus();
     void focus_toplevel(Toplevel *toplevel);
@@ -2,8 +2,10 @@
 #include <stdarg.h>
 #include <stdexcept>
 #include <string>
+#include <time.h>
 #include <unistd.h>
 
+#include "Layout.h"
 #include "wlr.h"
 
 // send a notification
@@ -30,6 +32,23 @@ inline void notify_send(const std::string &format, ...) {
     }
 }
 
+// get the monotonic time in nanoseconds
+inline int64_t get_time_nsec() {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+// convert a wlroots box to a core box
+inline Box to_box(const wlr_box &box) {
+    return {box.x, box.y, box.width, box.height};
+}
+
+// returns true if outer fully contains inner
+inline bool box_contains(const wlr_box &outer, const wlr_box &inner) {
+    return box_contains(to_box(outer), to_box(inner));
+}
+
 template <typename... Args>
 std::string string_format(const std::string &format, Args... args) {
     int size_s = std::snprintf(nullptr, 0, format.c_str(), args...) + 1;
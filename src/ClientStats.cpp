@@ -0,0 +1,191 @@
+#include "Server.h"
+#include <fstream>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+ClientSurface::ClientSurface(ClientStats *stats, wlr_surface *surface)
+    : stats(stats), surface(surface) {
+    wl_list_insert(&stats->surfaces, &link);
+
+    // commit
+    commit.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
+        ClientSurface *surface = wl_container_of(listener, surface, commit);
+        wlr_surface *wlr_surface = surface->surface;
+
+        // damaged buffer area of this commit
+        int count;
+        const pixman_box32_t *rects =
+            pixman_region32_rectangles(&wlr_surface->buffer_damage, &count);
+        uint64_t damage_px = 0;
+        for (int i = 0; i != count; ++i)
+            damage_px += static_cast<uint64_t>(rects[i].x2 - rects[i].x1) *
+                         (rects[i].y2 - rects[i].y1);
+
+        // assume 4 bytes per pixel, which most client buffers use
+        surface->buffer_bytes =
+            wlr_surface->buffer
+                ? static_cast<uint64_t>(wlr_surface->buffer->base.width) *
+                      wlr_surface->buffer->base.height * 4
+                : 0;
+
+        surface->stats->record_commit(damage_px);
+    };
+    wl_signal_add(&surface->events.commit, &commit);
+
+    // destroy
+    destroy.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
+        ClientSurface *surface = wl_container_of(listener, surface, destroy);
+        delete surface;
+    };
+    wl_signal_add(&surface->events.destroy, &destroy);
+}
+
+ClientSurface::~ClientSurface() {
+    wl_list_remove(&commit.link);
+    wl_list_remove(&destroy.link);
+    wl_list_remove(&link);
+}
+
+ClientStats::ClientStats(ClientTracker *tracker, wl_client *client)
+    : tracker(tracker), client(client), window_start_ns(get_time_nsec()) {
+    wl_list_init(&surfaces);
+    wl_client_get_credentials(client, &pid, nullptr, nullptr);
+
+    // destroy, sent before the client's surfaces are destroyed
+    destroy.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
+        ClientStats *stats = wl_container_of(listener, stats, destroy);
+        stats->tracker->clients.erase(stats->client);
+        delete stats;
+    };
+    wl_client_add_destroy_listener(client, &destroy);
+}
+
+ClientStats::~ClientStats() {
+    ClientSurface *surface, *tmp;
+    wl_list_for_each_safe(surface, tmp, &surfaces, link) delete surface;
+
+    wl_list_remove(&destroy.link);
+}
+
+void ClientStats::record_commit(const uint64_t damage_px) {
+    update_rates(get_time_nsec());
+
+    ++commits;
+    ++window_commits;
+    this->damage_px += damage_px;
+    window_damage_px += damage_px;
+}
+
+void ClientStats::record_configure(const int64_t ns) {
+    ++configures;
+    configure_total_ns += ns;
+    configure_max_ns = std::max(configure_max_ns, ns);
+}
+
+// close the rate window once a second has passed
+void ClientStats::update_rates(const int64_t now) {
+    const int64_t elapsed = now - window_start_ns;
+    if (elapsed < 1000000000)
+        return;
+
+    // the window of a quiet client spans its whole silence
+    const double seconds = elapsed / 1e9;
+    commit_rate = window_commits / seconds;
+    damage_rate = window_damage_px / seconds;
+
+    window_start_ns = now;
+    window_commits = 0;
+    window_damage_px = 0;
+}
+
+// memory of the buffers attached to the client's surfaces
+uint64_t ClientStats::buffer_bytes() const {
+    uint64_t bytes = 0;
+    ClientSurface *surface;
+    wl_list_for_each(surface, &surfaces, link) bytes += surface->buffer_bytes;
+    return bytes;
+}
+
+ClientTracker::ClientTracker(Server *server) : server(server) {
+    // new_surface
+    new_surface.notify = [](wl_listener *listener, void *data) {
+        ClientTracker *tracker =
+            wl_container_of(listener, tracker, new_surface);
+        auto *surface = static_cast<wlr_surface *>(data);
+
+        new ClientSurface(
+            tracker->get(wl_resource_get_client(surface->resource)), surface);
+    };
+    wl_signal_add(&server->compositor->events.new_surface, &new_surface);
+}
+
+ClientTracker::~ClientTracker() {
+    wl_list_remove(&new_surface.link);
+
+    for (const auto &[client, stats] : clients)
+        delete stats;
+}
+
+// the stats of a client, created on first use
+ClientStats *ClientTracker::get(wl_client *client) {
+    ClientStats *&stats = clients[client];
+    if (!stats)
+        stats = new ClientStats(this, client);
+    return stats;
+}
+
+// all clients as json, most costly first by commit rate, buffer memory or
+// damage rate
+std::string ClientTracker::list(const std::string &sort) {
+    const int64_t now = get_time_nsec();
+
+    std::vector<ClientStats *> sorted;
+    for (const auto &[client, stats] : clients) {
+        stats->update_rates(now);
+        sorted.emplace_back(stats);
+    }
+
+    std::sort(sorted.begin(), sorted.end(),
+              [&sort](const ClientStats *a, const ClientStats *b) {
+                  if (!sort.empty() && sort[0] == 'm') // memory
+                      return a->buffer_bytes() > b->buffer_bytes();
+                  if (!sort.empty() && sort[0] == 'd') // damage
+                      return a->damage_rate > b->damage_rate;
+                  return a->commit_rate > b->commit_rate;
+              });
+
+    json j = json::array();
+    for (const ClientStats *stats : sorted) {
+        size_t surfaces = 0, popups = 0;
+        ClientSurface *surface;
+        wl_list_for_each(surface, &stats->surfaces, link) {
+            ++surfaces;
+            if (wlr_xdg_popup_try_from_wlr_surface(surface->surface))
+                ++popups;
+        }
+
+        std::string command;
+        std::ifstream comm(string_format("/proc/%d/comm", stats->pid));
+        std::getline(comm, command);
+
+        j.push_back({
+            {"pid", stats->pid},
+            {"command", command},
+            {"surfaces", surfaces},
+            {"popups", popups},
+            {"commits", stats->commits},
+            {"commits_per_s", stats->commit_rate},
+            {"damage_px", stats->damage_px},
+            {"damage_px_per_s", stats->damage_rate},
+            {"buffer_bytes", stats->buffer_bytes()},
+            {"configures", stats->configures},
+            {"configure_avg_ms",
+             stats->configures
+                 ? stats->configure_total_ns / 1e6 / stats->configures
+                 : 0.0},
+            {"configure_max_ms", stats->configure_max_ns / 1e6},
+        });
+    }
+
+    return j.dump();
+}
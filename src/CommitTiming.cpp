@@ -0,0 +1,234 @@
+#include "Server.h"
+#include "commit-timing-v1-protocol.h"
+
+static const struct wp_commit_timer_v1_interface commit_timer_impl = {
+    .set_timestamp =
+        []([[maybe_unused]] wl_client *client, wl_resource *resource,
+           const uint32_t tv_sec_hi, const uint32_t tv_sec_lo,
+           const uint32_t tv_nsec) {
+            auto *timer =
+                static_cast<CommitTimer *>(wl_resource_get_user_data(resource));
+            if (!timer->surface) {
+                wl_resource_post_error(
+                    resource, WP_COMMIT_TIMER_V1_ERROR_SURFACE_DESTROYED,
+                    "surface destroyed");
+                return;
+            }
+
+            if (tv_nsec >= 1000000000) {
+                wl_resource_post_error(
+                    resource, WP_COMMIT_TIMER_V1_ERROR_INVALID_TIMESTAMP,
+                    "invalid timestamp");
+                return;
+            }
+
+            if (timer->timestamp_ns) {
+                wl_resource_post_error(
+                    resource, WP_COMMIT_TIMER_V1_ERROR_TIMESTAMP_EXISTS,
+                    "timestamp already set for this commit");
+                return;
+            }
+
+            const int64_t tv_sec =
+                static_cast<int64_t>(tv_sec_hi) << 32 | tv_sec_lo;
+            timer->timestamp_ns = tv_sec * 1000000000ll + tv_nsec;
+        },
+    .destroy = []([[maybe_unused]] wl_client *client,
+                  wl_resource *resource) { wl_resource_destroy(resource); },
+};
+
+static const struct wp_commit_timing_manager_v1_interface
+    commit_timing_manager_impl = {
+        .destroy = []([[maybe_unused]] wl_client *client,
+                      wl_resource *resource) { wl_resource_destroy(resource); },
+        .get_timer =
+            [](wl_client *client, wl_resource *resource, const uint32_t id,
+               wl_resource *surface_resource) {
+                auto *manager = static_cast<CommitTimingManager *>(
+                    wl_resource_get_user_data(resource));
+                wlr_surface *surface =
+                    wlr_surface_from_resource(surface_resource);
+
+                // one timer per surface
+                CommitTimer *timer;
+                wl_list_for_each(timer, &manager->timers, link) {
+                    if (timer->surface == surface) {
+                        wl_resource_post_error(
+                            resource,
+                            WP_COMMIT_TIMING_MANAGER_V1_ERROR_COMMIT_TIMER_EXISTS,
+                            "surface already has a commit timer");
+                        return;
+                    }
+                }
+
+                wl_resource *timer_resource =
+                    wl_resource_create(client, &wp_commit_timer_v1_interface,
+                                       wl_resource_get_version(resource), id);
+                if (!timer_resource) {
+                    wl_client_post_no_memory(client);
+                    return;
+                }
+
+                new CommitTimer(manager, timer_resource, surface);
+            },
+};
+
+CommitTimer::CommitTimer(CommitTimingManager *manager, wl_resource *resource,
+                         wlr_surface *surface)
+    : manager(manager), resource(resource), surface(surface) {
+    wl_list_insert(&manager->timers, &link);
+
+    wl_resource_set_implementation(
+        resource, &commit_timer_impl, this, [](wl_resource *resource) {
+            delete static_cast<CommitTimer *>(
+                wl_resource_get_user_data(resource));
+        });
+
+    // release held commits whose output is idle
+    timer = wl_event_loop_add_timer(
+        wl_display_get_event_loop(manager->server->display),
+        [](void *data) {
+            auto *timer = static_cast<CommitTimer *>(data);
+            if (!timer->surface)
+                return 0;
+
+            // surfaces that can not be seen are released on time
+            if (wl_list_empty(&timer->surface->current_outputs)) {
+                timer->release(get_time_nsec());
+                return 0;
+            }
+
+            // otherwise the next render decides
+            wlr_surface_output *surface_output;
+            wl_list_for_each(surface_output, &timer->surface->current_outputs,
+                             link)
+                wlr_output_schedule_frame(surface_output->output);
+            return 0;
+        },
+        this);
+
+    // client_commit
+    client_commit.notify = [](wl_listener *listener,
+                              [[maybe_unused]] void *data) {
+        CommitTimer *timer = wl_container_of(listener, timer, client_commit);
+
+        const int64_t target = timer->timestamp_ns;
+        timer->timestamp_ns = 0;
+
+        // no target, or one that has already passed, with nothing held
+        if (!target ||
+            (timer->pending.empty() && target <= get_time_nsec()))
+            return;
+
+        // hold the commit until its target presentation time
+        timer->pending.emplace_back(wlr_surface_lock_pending(timer->surface),
+                                    target);
+        timer->arm();
+    };
+    wl_signal_add(&surface->events.client_commit, &client_commit);
+
+    // surface_destroy
+    surface_destroy.notify = [](wl_listener *listener,
+                                [[maybe_unused]] void *data) {
+        CommitTimer *timer = wl_container_of(listener, timer, surface_destroy);
+        timer->pending.clear();
+        timer->release_surface();
+    };
+    wl_signal_add(&surface->events.destroy, &surface_destroy);
+}
+
+CommitTimer::~CommitTimer() {
+    // apply any held commits
+    if (surface)
+        for (const auto &[seq, target] : pending)
+            wlr_surface_unlock_cached(surface, seq);
+
+    wl_event_source_remove(timer);
+    release_surface();
+    wl_list_remove(&link);
+}
+
+// stop tracking the surface
+void CommitTimer::release_surface() {
+    if (!surface)
+        return;
+
+    wl_event_source_timer_update(timer, 0);
+    wl_list_remove(&client_commit.link);
+    wl_list_remove(&surface_destroy.link);
+    surface = nullptr;
+}
+
+// returns true if the surface is shown on the output
+bool CommitTimer::on_output(const Output *output) const {
+    if (!surface)
+        return false;
+
+    wlr_surface_output *surface_output;
+    wl_list_for_each(surface_output, &surface->current_outputs, link) if (
+        surface_output->output == output->wlr_output) return true;
+
+    return false;
+}
+
+// apply the held commits targeting a presentation at or before present_ns
+void CommitTimer::release(const int64_t present_ns) {
+    while (!pending.empty() && pending.front().second <= present_ns) {
+        const uint32_t seq = pending.front().first;
+        pending.pop_front();
+        wlr_surface_unlock_cached(surface, seq);
+    }
+
+    arm();
+}
+
+// wake up a refresh before the first held commit is due
+void CommitTimer::arm() const {
+    if (pending.empty()) {
+        wl_event_source_timer_update(timer, 0);
+        return;
+    }
+
+    // lead by the longest refresh interval of the surface's outputs
+    int64_t lead_ns = 0;
+    wlr_surface_output *surface_output;
+    wl_list_for_each(surface_output, &surface->current_outputs, link) if (
+        surface_output->output->refresh > 0) lead_ns =
+        std::max(lead_ns, 1000000000000ll / surface_output->output->refresh);
+
+    const int64_t delay_ms =
+        (pending.front().second - lead_ns - get_time_nsec()) / 1000000;
+    wl_event_source_timer_update(
+        timer, static_cast<int>(std::max<int64_t>(delay_ms, 1)));
+}
+
+CommitTimingManager::CommitTimingManager(Server *server) : server(server) {
+    wl_list_init(&timers);
+
+    global = wl_global_create(
+        server->display, &wp_commit_timing_manager_v1_interface, 1, this,
+        [](wl_client *client, void *data, const uint32_t version,
+           const uint32_t id) {
+            wl_resource *resource = wl_resource_create(
+                client, &wp_commit_timing_manager_v1_interface, version, id);
+            if (!resource) {
+                wl_client_post_no_memory(client);
+                return;
+            }
+
+            wl_resource_set_implementation(
+                resource, &commit_timing_manager_impl, data, nullptr);
+        });
+}
+
+CommitTimingManager::~CommitTimingManager() { wl_global_destroy(global); }
+
+// an output is about to render a frame presented at present_ns, release the
+// held commits of its surfaces that are due by then
+void CommitTimingManager::output_rendering(const Output *output,
+                                           const int64_t present_ns) const {
+    CommitTimer *timer, *tmp;
+    wl_list_for_each_safe(timer, tmp, &timers, link) if (
+        timer->surface && !timer->pending.empty() && timer->on_output(output))
+        timer->release(present_ns);
+}
@@ -72,6 +72,19 @@ template <typename T> void connect(const std::pair<bool, T> &pair, T *target) {
         *target = pair.second;
 }
 
+// returns true if the rule applies to a window, app_id must match exactly and
+// title must be contained in the window title
+bool WindowRule::matches(const std::string &app_id,
+                         const std::string &title) const {
+    if (!this->app_id.empty() && this->app_id != app_id)
+        return false;
+
+    if (!this->title.empty() && title.find(this->title) == std::string::npos)
+        return false;
+
+    return true;
+}
+
 Config::Config() {
     path = "";
     last_write_time = std::filesystem::file_time_type::min();
@@ -168,6 +181,50 @@ bool Config::load() {
         }
     }
 
+    // frame rate caps
+    std::unique_ptr<toml::Table> frame_rate_table =
+        config_file.table->getTable("frame_rate");
+    if (frame_rate_table) {
+        // unfocused toplevels
+        connect(frame_rate_table->getInt("unfocused"), &frame_rate.unfocused);
+
+        // layer shell background surfaces
+        connect(frame_rate_table->getInt("background"), &frame_rate.background);
+    }
+
+    // render
+    std::unique_ptr<toml::Table> render_table =
+        config_file.table->getTable("render");
+    if (render_table) {
+        // frame scheduling
+        connect(render_table->getBool("schedule_frames"),
+                &render.schedule_frames);
+
+        // safety margin
+        connect(render_table->getInt("safety_margin"), &render.safety_margin);
+
+        // idle timeout
+        connect(render_table->getInt("idle_timeout"), &render.idle_timeout);
+    }
+
+    // log
+    std::unique_ptr<toml::Table> log_table = config_file.table->getTable("log");
+    if (log_table) {
+        connect(log_table->getString("level"), &log.level);
+        connect(log_table->getString("file"), &log.file);
+    }
+
+    // watchdog
+    std::unique_ptr<toml::Table> watchdog_table =
+        config_file.table->getTable("watchdog");
+    if (watchdog_table) {
+        connect(watchdog_table->getBool("enabled"), &watchdog.enabled);
+        connect(watchdog_table->getInt("threshold"), &watchdog.threshold);
+        connect(watchdog_table->getString("directory"), &watchdog.directory);
+        connect(watchdog_table->getInt("cooldown"), &watchdog.cooldown);
+        connect(watchdog_table->getInt("max_reports"), &watchdog.max_reports);
+    }
+
     // get keyboard config
     std::unique_ptr<toml::Table> keyboard =
         config_file.table->getTable("keyboard");
@@ -417,6 +474,47 @@ bool Config::load() {
         wlr_log(WLR_INFO, "No user-defined commands set, ignoring");
     }
 
+    // window rules
+    std::unique_ptr<toml::Array> rule_tables =
+        config_file.table->getArray("rules");
+    if (rule_tables) {
+        // clear rules
+        rules.clear();
+
+        if (auto tables = rule_tables->getTableVector())
+            for (toml::Table &table : *tables) {
+                WindowRule rule;
+
+                // app_id
+                connect(table.getString("app_id"), &rule.app_id);
+
+                // title
+                connect(table.getString("title"), &rule.title);
+
+                // frame rate cap
+                connect(table.getInt("max_fps"), &rule.max_fps);
+
+                // max render time, in ms or "auto"
+                connect(table.getInt("max_render_time"), &rule.max_render_time);
+                if (auto [fst, snd] = table.getString("max_render_time"); fst) {
+                    if (snd == "auto")
+                        rule.max_render_time = -1;
+                    else if (snd == "off")
+                        rule.max_render_time = 0;
+                    else
+                        notify_send("No such option in rules.max_render_time "
+                                    "['off', 'auto', <ms>]: %s",
+                                    snd.c_str());
+                }
+
+                // tearing
+                if (auto [fst, snd] = table.getBool("tearing"); fst)
+                    rule.tearing = snd;
+
+                rules.emplace_back(rule);
+            }
+    }
+
     // monitor configs
     std::unique_ptr<toml::Array> monitor_tables =
         config_file.table->getArray("monitors");
@@ -464,6 +562,28 @@ bool Config::load() {
 
                 // adaptive sync
                 connect(table.getBool("adaptive"), &oc->adaptive_sync);
+                if (auto [fst, snd] = table.getString("adaptive"); fst) {
+                    if (snd == "auto")
+                        oc->adaptive_sync_auto = true;
+                    else
+                        notify_send("No such option in monitors.adaptive "
+                                    "[true, false, 'auto']: %s",
+                                    snd.c_str());
+                }
+
+                // refresh rate for desktop content
+                connect(table.getDouble("desktop_refresh"),
+                        &oc->desktop_refresh);
+
+                // refresh rate when idle
+                connect(table.getDouble("idle_refresh"), &oc->idle_refresh);
+
+                // frame rate caps
+                connect(table.getInt("unfocused_fps"), &oc->unfocused_fps);
+                connect(table.getInt("background_fps"), &oc->background_fps);
+
+                // tearing
+                connect(table.getBool("allow_tearing"), &oc->allow_tearing);
 
                 // add to output configs if enough values are set
                 if (oc->name.empty() || !oc->width || !oc->height ||
@@ -485,6 +605,10 @@ bool Config::load() {
 
 // update the config
 void Config::update(const Server *server) {
+    // running on defaults
+    if (path.empty())
+        return;
+
     // get current write time
     const std::filesystem::file_time_type current_write_time =
         std::filesystem::last_write_time(path);
@@ -509,5 +633,7 @@ void Config::update(const Server *server) {
     server->cursor->reconfigure_all();
 
     // notify user of reload
+    AWM_PROBE(config_reload, path.c_str());
+    ++server->metrics.config_reloads;
     notify_send("config reload complete");
 }
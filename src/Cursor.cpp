@@ -34,6 +34,8 @@ Cursor::Cursor(Server *server) : server(server) {
         // relative motion event
         Cursor *cursor = wl_container_of(listener, cursor, motion);
         const auto *event = static_cast<wlr_pointer_motion_event *>(data);
+        if (cursor->server->records(&event->pointer->base))
+            cursor->server->input_recorder->motion(event);
 
         // process motion
         cursor->process_motion(event->time_msec, &event->pointer->base,
@@ -48,6 +50,9 @@ Cursor::Cursor(Server *server) : server(server) {
         Cursor *cursor = wl_container_of(listener, cursor, motion_absolute);
         const auto *event =
             static_cast<wlr_pointer_motion_absolute_event *>(data);
+        if (event->time_msec &&
+            cursor->server->records(&event->pointer->base))
+            cursor->server->input_recorder->motion_absolute(event);
 
         // warp cursor
         if (event->time_msec)
@@ -72,6 +77,9 @@ Cursor::Cursor(Server *server) : server(server) {
     button.notify = [](wl_listener *listener, void *data) {
         Cursor *cursor = wl_container_of(listener, cursor, button);
         const auto *event = static_cast<wlr_pointer_button_event *>(data);
+        cursor->server->notify_activity();
+        if (cursor->server->records(&event->pointer->base))
+            cursor->server->input_recorder->button(event);
 
         // forward to seat
         wlr_seat_pointer_notify_button(cursor->server->seat, event->time_msec,
@@ -110,6 +118,9 @@ Cursor::Cursor(Server *server) : server(server) {
         Cursor *cursor = wl_container_of(listener, cursor, axis);
 
         const auto *event = static_cast<wlr_pointer_axis_event *>(data);
+        cursor->server->notify_activity();
+        if (cursor->server->records(&event->pointer->base))
+            cursor->server->input_recorder->axis(event);
 
         // forward to seat
         wlr_seat_pointer_notify_axis(cursor->server->seat, event->time_msec,
@@ -143,13 +154,25 @@ Cursor::~Cursor() {
 
 // deactivate cursor
 void Cursor::reset_mode() {
+    // index the final geometry of the grabbed toplevel
+    if (server->grabbed_toplevel) {
+        server->toplevel_index->update(server->grabbed_toplevel);
+        server->schedule_visibility();
+    }
+
     cursor_mode = CURSORMODE_PASSTHROUGH;
     server->grabbed_toplevel = nullptr;
+    grab_workspace = nullptr;
+    grab_output = nullptr;
 }
 
 void Cursor::process_motion(uint32_t time, wlr_input_device *device, double dx,
                             double dy, double unaccel_dx, double unaccel_dy) {
+    TraceSpan span("process_motion");
+
     if (time) {
+        server->notify_activity();
+
         // send relative motion event
         wlr_relative_pointer_manager_v1_send_relative_motion(
             server->wlr_relative_pointer_manager, server->seat,
@@ -234,35 +257,47 @@ void Cursor::process_motion(uint32_t time, wlr_input_device *device, double dx,
 
 // move a toplevel
 void Cursor::process_move() {
+    Toplevel *toplevel = server->grabbed_toplevel;
+
     // do not move fullscreen toplevel
-    if ((server->grabbed_toplevel->xdg_toplevel &&
-         server->grabbed_toplevel->xdg_toplevel->current.fullscreen)
+    if ((toplevel->xdg_toplevel && toplevel->xdg_toplevel->current.fullscreen)
 #ifdef XWAYLAND
-        || (server->grabbed_toplevel->xwayland_surface &&
-            server->grabbed_toplevel->xwayland_surface->fullscreen)
+        ||
+        (toplevel->xwayland_surface && toplevel->xwayland_surface->fullscreen)
 #endif
     )
         return;
 
-    // get the output of the current workspace
-    Workspace *current = server->get_workspace(server->grabbed_toplevel);
-
     // calculate new x and y based on cursor position
-    double new_x = cursor->x - grab_x;
-    double new_y = cursor->y - grab_y;
+    const int new_x = cursor->x - grab_x;
+    const int new_y = cursor->y - grab_y;
 
     // set the new position
-    wlr_scene_node_set_position(&server->grabbed_toplevel->scene_tree->node,
-                                new_x, new_y);
+    wlr_scene_node_set_position(&toplevel->scene_tree->node, new_x, new_y);
 
     // update position
-    server->grabbed_toplevel->geometry.x = new_x;
-    server->grabbed_toplevel->geometry.y = new_y;
+    toplevel->geometry.x = new_x;
+    toplevel->geometry.y = new_y;
+
+    // still on the output the grab is homed on
+    if (wlr_box_contains_point(&grab_output_box, cursor->x, cursor->y))
+        return;
 
-    // move toplevel to different workspace if it's moved into other output
-    Workspace *target = server->focused_output()->get_active();
-    if (!target->contains(server->grabbed_toplevel) && current)
-        current->move_to(server->grabbed_toplevel, target);
+    // cursor crossed into another output, ignore gaps between outputs
+    Output *output = server->output_manager->output_at(cursor->x, cursor->y);
+    if (!output)
+        return;
+
+    // re-home the toplevel to the active workspace of the new output
+    Workspace *target = output->get_active();
+    if (grab_workspace && target && grab_workspace != target)
+        grab_workspace->move_to(toplevel, target);
+    toplevel->update_scale(output);
+
+    // cache the new home of the grab
+    grab_workspace = target;
+    grab_output = output;
+    grab_output_box = output->layout_geometry;
 }
 
 // resize a toplevel
@@ -314,6 +349,9 @@ void Cursor::process_resize() {
     int new_width = new_right - new_left;
     int new_height = new_bottom - new_top;
 
+    // show the last frame until the client redraws
+    toplevel->create_snapshot();
+
     // set new geometry
     wlr_scene_node_set_position(&toplevel->scene_tree->node, new_x, new_y);
 
@@ -322,7 +360,8 @@ void Cursor::process_resize() {
 #endif
         wlr_xdg_toplevel_set_size(toplevel->xdg_toplevel, new_width,
                                   new_height);
-        wlr_xdg_surface_schedule_configure(toplevel->xdg_toplevel->base);
+        toplevel->configure_serial =
+            wlr_xdg_surface_schedule_configure(toplevel->xdg_toplevel->base);
 #ifdef XWAYLAND
     } else
         wlr_xwayland_surface_configure(toplevel->xwayland_surface, new_x, new_y,
@@ -333,6 +372,9 @@ void Cursor::process_resize() {
     toplevel->geometry.y = new_y;
     toplevel->geometry.width = new_width;
     toplevel->geometry.height = new_height;
+
+    // scale the snapshot to the new geometry
+    toplevel->update_snapshot();
 }
 
 // constrain the cursor to a given pointer constraint
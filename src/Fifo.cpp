@@ -0,0 +1,206 @@
+#include "Server.h"
+#include "fifo-v1-protocol.h"
+
+static const struct wp_fifo_v1_interface fifo_impl = {
+    .set_barrier =
+        []([[maybe_unused]] wl_client *client, wl_resource *resource) {
+            auto *fifo =
+                static_cast<Fifo *>(wl_resource_get_user_data(resource));
+            if (!fifo->surface) {
+                wl_resource_post_error(resource,
+                                       WP_FIFO_V1_ERROR_SURFACE_DESTROYED,
+                                       "surface destroyed");
+                return;
+            }
+
+            fifo->set_barrier = true;
+        },
+    .wait_barrier =
+        []([[maybe_unused]] wl_client *client, wl_resource *resource) {
+            auto *fifo =
+                static_cast<Fifo *>(wl_resource_get_user_data(resource));
+            if (!fifo->surface) {
+                wl_resource_post_error(resource,
+                                       WP_FIFO_V1_ERROR_SURFACE_DESTROYED,
+                                       "surface destroyed");
+                return;
+            }
+
+            fifo->wait_barrier = true;
+        },
+    .destroy = []([[maybe_unused]] wl_client *client,
+                  wl_resource *resource) { wl_resource_destroy(resource); },
+};
+
+static const struct wp_fifo_manager_v1_interface fifo_manager_impl = {
+    .destroy = []([[maybe_unused]] wl_client *client,
+                  wl_resource *resource) { wl_resource_destroy(resource); },
+    .get_fifo =
+        [](wl_client *client, wl_resource *resource, const uint32_t id,
+           wl_resource *surface_resource) {
+            auto *manager = static_cast<FifoManager *>(
+                wl_resource_get_user_data(resource));
+            wlr_surface *surface = wlr_surface_from_resource(surface_resource);
+
+            // one fifo per surface
+            Fifo *fifo;
+            wl_list_for_each(fifo, &manager->fifos, link) {
+                if (fifo->surface == surface) {
+                    wl_resource_post_error(
+                        resource, WP_FIFO_MANAGER_V1_ERROR_ALREADY_EXISTS,
+                        "surface already has a fifo object");
+                    return;
+                }
+            }
+
+            wl_resource *fifo_resource =
+                wl_resource_create(client, &wp_fifo_v1_interface,
+                                   wl_resource_get_version(resource), id);
+            if (!fifo_resource) {
+                wl_client_post_no_memory(client);
+                return;
+            }
+
+            new Fifo(manager, fifo_resource, surface);
+        },
+};
+
+Fifo::Fifo(FifoManager *manager, wl_resource *resource, wlr_surface *surface)
+    : manager(manager), resource(resource), surface(surface) {
+    wl_list_insert(&manager->fifos, &link);
+
+    wl_resource_set_implementation(
+        resource, &fifo_impl, this, [](wl_resource *resource) {
+            delete static_cast<Fifo *>(wl_resource_get_user_data(resource));
+        });
+
+    // client_commit
+    client_commit.notify = [](wl_listener *listener,
+                              [[maybe_unused]] void *data) {
+        Fifo *fifo = wl_container_of(listener, fifo, client_commit);
+
+        // barriers of surfaces that can not be seen clear immediately
+        if (!fifo->visible())
+            fifo->barrier = false;
+
+        if (fifo->wait_barrier && (fifo->barrier || !fifo->waiting.empty())) {
+            // hold the commit until the barrier is cleared
+            fifo->waiting.emplace_back(wlr_surface_lock_pending(fifo->surface),
+                                       fifo->set_barrier);
+            fifo->schedule_frame();
+        } else if (fifo->set_barrier)
+            fifo->barrier = true;
+
+        fifo->set_barrier = false;
+        fifo->wait_barrier = false;
+    };
+    wl_signal_add(&surface->events.client_commit, &client_commit);
+
+    // surface_destroy
+    surface_destroy.notify = [](wl_listener *listener,
+                                [[maybe_unused]] void *data) {
+        Fifo *fifo = wl_container_of(listener, fifo, surface_destroy);
+        fifo->waiting.clear();
+        fifo->release_surface();
+    };
+    wl_signal_add(&surface->events.destroy, &surface_destroy);
+}
+
+Fifo::~Fifo() {
+    // apply any held commits
+    if (surface)
+        for (const auto &[seq, sets_barrier] : waiting)
+            wlr_surface_unlock_cached(surface, seq);
+
+    release_surface();
+    wl_list_remove(&link);
+}
+
+// stop tracking the surface
+void Fifo::release_surface() {
+    if (!surface)
+        return;
+
+    wl_list_remove(&client_commit.link);
+    wl_list_remove(&surface_destroy.link);
+    surface = nullptr;
+}
+
+// returns true if the surface is shown on any output
+bool Fifo::visible() const {
+    return surface && !wl_list_empty(&surface->current_outputs);
+}
+
+// returns true if the surface is shown on the output
+bool Fifo::on_output(const Output *output) const {
+    if (!surface)
+        return false;
+
+    wlr_surface_output *surface_output;
+    wl_list_for_each(surface_output, &surface->current_outputs, link) if (
+        surface_output->output == output->wlr_output) return true;
+
+    return false;
+}
+
+// the last barrier was latched, clear it and apply the next held commit
+void Fifo::advance() {
+    barrier = false;
+
+    if (waiting.empty())
+        return;
+
+    const auto [seq, sets_barrier] = waiting.front();
+    waiting.pop_front();
+
+    barrier = sets_barrier;
+    wlr_surface_unlock_cached(surface, seq);
+
+    // more commits are waiting on the next refresh
+    if (!waiting.empty())
+        schedule_frame();
+}
+
+// make sure a refresh happens so held commits make progress
+void Fifo::schedule_frame() const {
+    if (!visible()) {
+        // any output refresh releases surfaces that can not be seen
+        Output *output;
+        wl_list_for_each(output, &manager->server->output_manager->outputs,
+                         link) wlr_output_schedule_frame(output->wlr_output);
+        return;
+    }
+
+    wlr_surface_output *surface_output;
+    wl_list_for_each(surface_output, &surface->current_outputs, link)
+        wlr_output_schedule_frame(surface_output->output);
+}
+
+FifoManager::FifoManager(Server *server) : server(server) {
+    wl_list_init(&fifos);
+
+    global = wl_global_create(
+        server->display, &wp_fifo_manager_v1_interface, 1, this,
+        [](wl_client *client, void *data, const uint32_t version,
+           const uint32_t id) {
+            wl_resource *resource = wl_resource_create(
+                client, &wp_fifo_manager_v1_interface, version, id);
+            if (!resource) {
+                wl_client_post_no_memory(client);
+                return;
+            }
+
+            wl_resource_set_implementation(resource, &fifo_manager_impl, data,
+                                           nullptr);
+        });
+}
+
+FifoManager::~FifoManager() { wl_global_destroy(global); }
+
+// an output refreshed, advance the fifos of the surfaces on it
+void FifoManager::output_rendered(const Output *output) const {
+    Fifo *fifo, *tmp;
+    wl_list_for_each_safe(fifo, tmp, &fifos, link) if (
+        fifo->surface && (fifo->on_output(output) || !fifo->visible()))
+        fifo->advance();
+}
@@ -1,8 +1,92 @@
 #include "Server.h"
 #include <nlohmann/json.hpp>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
 using json = nlohmann::json;
 
-IPC::IPC(Server *server) : server(server) {
+// summarize the recent frame statistics of an output
+json frame_stats(const Output *output) {
+    // commit duration histogram buckets, upper bounds in ms
+    const int64_t bounds[] = {1, 2, 4, 8, 16};
+    uint64_t commit_histogram[std::size(bounds) + 1]{};
+
+    // presentation interval histogram, in refresh intervals
+    uint64_t interval_histogram[5]{};
+
+    std::vector<int64_t> commits;
+    commits.reserve(output->frame_stats_count);
+
+    int64_t previous_present = 0;
+    for (size_t i = 0; i != output->frame_stats_count; ++i) {
+        // oldest first
+        const size_t size = output->frame_stats.size();
+        const size_t index =
+            (output->frame_stats_next + size - output->frame_stats_count + i) %
+            size;
+        const FrameStats &stats = output->frame_stats[index];
+
+        commits.emplace_back(stats.commit_ns);
+
+        size_t bucket = 0;
+        while (bucket != std::size(bounds) &&
+               stats.commit_ns >= bounds[bucket] * 1000000)
+            ++bucket;
+        ++commit_histogram[bucket];
+
+        if (!stats.present_ns)
+            continue;
+
+        // count intervals of 1, 2, 3, 4 and more refreshes
+        if (previous_present && stats.refresh_ns > 0) {
+            const int64_t refreshes =
+                (stats.present_ns - previous_present + stats.refresh_ns / 2) /
+                stats.refresh_ns;
+            ++interval_histogram[std::clamp<int64_t>(refreshes, 0, 4)];
+        }
+        previous_present = stats.present_ns;
+    }
+
+    // commit duration percentiles in ms
+    std::sort(commits.begin(), commits.end());
+    auto percentile = [&commits](const size_t p) {
+        return commits.empty() ? 0.0
+                               : commits[(commits.size() - 1) * p / 100] / 1e6;
+    };
+
+    json j = {
+        {"frames",
+         {
+             {"presented", output->frames_presented},
+             {"discarded", output->frames_discarded},
+             {"missed_vblanks", output->frames_missed},
+             {"empty", output->frames_empty},
+         }},
+        {"commit_ms",
+         {
+             {"p50", percentile(50)},
+             {"p90", percentile(90)},
+             {"p99", percentile(99)},
+             {"max", percentile(100)},
+         }},
+        {"samples", output->frame_stats_count},
+    };
+
+    for (size_t i = 0; i != std::size(bounds) + 1; ++i)
+        j["commit_histogram"]
+         [i == std::size(bounds) ? string_format(">=%ldms", bounds[i - 1])
+                                 : string_format("<%ldms", bounds[i])] =
+             commit_histogram[i];
+
+    j["interval_histogram"] = {
+        {"early", interval_histogram[0]}, {"1", interval_histogram[1]},
+        {"2", interval_histogram[2]},     {"3", interval_histogram[3]},
+        {">=4", interval_histogram[4]},
+    };
+
+    return j;
+}
+
+IPC::IPC(Server *server) : server(server), path(server->config->ipc_socket) {
     // create file descriptor
     fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (fd == -1) {
@@ -12,6 +96,19 @@ IPC::IPC(Server *server) : server(server) {
 
     wlr_log(WLR_INFO, "starting IPC on socket %d", fd);
 
+    // wake the event loop for queued tasks
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd != -1)
+        wake_source = wl_event_loop_add_fd(
+            wl_display_get_event_loop(server->display), wake_fd,
+            WL_EVENT_READABLE,
+            []([[maybe_unused]] int fd, [[maybe_unused]] uint32_t mask,
+               void *data) {
+                static_cast<IPC *>(data)->run_tasks();
+                return 0;
+            },
+            this);
+
     // unlink old socket if present
     if (!unlink(path.c_str()))
         wlr_log(WLR_INFO, "removed old socket at path `%s`", path.c_str());
@@ -41,6 +138,8 @@ IPC::IPC(Server *server) : server(server) {
         while (running) {
             // accept connections
             int client_fd = accept(fd, nullptr, nullptr);
+            if (client_fd == -1 && !running)
+                break;
             if (client_fd == -1) {
                 wlr_log(WLR_ERROR,
                         "failed to accept connection on socket with fd `%d` on "
@@ -49,6 +148,11 @@ IPC::IPC(Server *server) : server(server) {
                 continue;
             }
 
+            // a silent client must not keep the thread from stopping
+            const timeval timeout{.tv_sec = 1, .tv_usec = 0};
+            setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                       sizeof(timeout));
+
             // read from client
             char buffer[1024];
             int len = read(client_fd, buffer, sizeof(buffer));
@@ -61,7 +165,10 @@ IPC::IPC(Server *server) : server(server) {
             }
 
             // run command
+            const int64_t start = get_time_nsec();
             std::string response = run(std::string(buffer, len));
+            ++server->metrics.ipc_requests;
+            server->metrics.ipc_duration.observe(get_time_nsec() - start);
 
             // write response to client
             if (write(client_fd, response.c_str(), strlen(response.c_str())) ==
@@ -76,14 +183,91 @@ IPC::IPC(Server *server) : server(server) {
     });
 }
 
+// number of toplevels on all workspaces of all outputs
+static size_t toplevel_count(const Server *server) {
+    size_t count = 0;
+    Output *output;
+    Workspace *workspace;
+    wl_list_for_each(output, &server->output_manager->outputs, link)
+        wl_list_for_each(workspace, &output->workspaces, link) count +=
+        wl_list_length(&workspace->toplevels);
+    return count;
+}
+
+// run a benchmark command on the event loop
+std::string IPC::run_bench(const std::string &command, std::stringstream &ss) {
+    std::string argument;
+    std::getline(ss, argument, ' ');
+
+    return run_on_loop([this, command, argument]() -> std::string {
+        json j;
+
+        if (command[0] == 'p') // bench ping
+            j = json::object();
+        else if (command[0] == 's') { // bench stats
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+            const int64_t cpu_ns =
+                (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ll +
+                (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ll;
+
+            uint64_t frames = 0;
+            Output *output;
+            wl_list_for_each(output, &server->output_manager->outputs, link)
+                frames += output->frames_presented + output->frames_discarded;
+
+            j = {
+                {"cpu_ns", cpu_ns},
+                {"frames", frames},
+                {"toplevels", toplevel_count(server)},
+            };
+        } else if (command[0] == 't') { // bench tile [repeat]
+            Output *output = server->focused_output();
+            Workspace *workspace = output ? output->get_active() : nullptr;
+            if (!workspace)
+                return "";
+
+            const int repeat =
+                std::max(argument.empty() ? 1 : std::atoi(argument.c_str()), 1);
+            const int64_t start = get_time_nsec();
+            for (int i = 0; i != repeat; ++i)
+                workspace->tile();
+
+            j = {
+                {"windows", wl_list_length(&workspace->toplevels)},
+                {"ns", (get_time_nsec() - start) / repeat},
+            };
+        } else if (command[0] == 'w') { // bench workspace <n>
+            Output *output = server->focused_output();
+            if (!output || argument.empty())
+                return "";
+
+            const int64_t start = get_time_nsec();
+            const bool success = output->set_workspace(
+                static_cast<uint32_t>(std::atoi(argument.c_str())));
+
+            j = {
+                {"success", success},
+                {"ns", get_time_nsec() - start},
+            };
+        } else
+            return "";
+
+        return j.dump();
+    });
+}
+
 // run a received command
 std::string IPC::run(std::string command) {
+    TraceSpan span("ipc_command");
+
     std::string response;
     std::string token;
     std::stringstream ss(command);
     json j;
 
-    wlr_log(WLR_INFO, "received command `%s`", command.c_str());
+    wlr_log(WLR_DEBUG, "received command `%s`", command.c_str());
+    AWM_PROBE(ipc_begin, command.c_str());
 
     if (std::getline(ss, token, ' ')) {
         if (token[0] == 'e') // exit
@@ -127,6 +311,19 @@ std::string IPC::run(std::string command) {
                     }
 
                     response = j.dump();
+                } else if (token[0] == 's') { // output stats
+                    // frame statistics are written by the event loop
+                    response = run_on_loop([this]() {
+                        json stats = json::object();
+
+                        Output *output;
+                        wl_list_for_each(output,
+                                         &server->output_manager->outputs, link)
+                            stats[output->wlr_output->name] =
+                                frame_stats(output);
+
+                        return stats.dump();
+                    });
                 }
             }
         } else if (token[0] == 'w') { // workspace
@@ -163,6 +360,9 @@ std::string IPC::run(std::string command) {
                     response = j.dump();
                 }
             }
+        } else if (token == "trace") { // trace
+            if (std::getline(ss, token, ' ') && token[0] == 'd') // trace dump
+                response = trace_dump();
         } else if (token[0] == 't') { // toplevel
             if (std::getline(ss, token, ' ')) {
                 if (token[0] == 'l') { // toplevel list
@@ -193,27 +393,119 @@ std::string IPC::run(std::string command) {
                     response = j.dump();
                 }
             }
+        } else if (token[0] == 'l') { // log
+            if (std::getline(ss, token, ' ') && token[0] == 't' &&
+                LogSink::instance) { // log tail [n]
+                std::string argument;
+                std::getline(ss, argument, ' ');
+                const int count =
+                    argument.empty() ? 50 : std::atoi(argument.c_str());
+                response = json(LogSink::instance->tail(
+                                    static_cast<size_t>(std::max(count, 0))))
+                               .dump();
+            }
+        } else if (token[0] == 'c') { // client
+            if (std::getline(ss, token, ' ') && token[0] == 'l') {
+                // client list [commits|memory|damage]
+                std::string sort;
+                std::getline(ss, sort, ' ');
+                response = run_on_loop([this, sort]() {
+                    return server->client_tracker->list(sort);
+                });
+            }
+        } else if (token[0] == 'm') // metrics
+            response = run_on_loop(
+                [this]() { return server->metrics.expose(server); });
+        else if (token[0] == 'b') { // bench
+            if (std::getline(ss, token, ' '))
+                response = run_bench(token, ss);
         } else
             notify_send("unknown command `%s`", token.c_str());
     }
 
+    AWM_PROBE(ipc_end, command.c_str(), response.size());
     return response;
 }
 
+// run a task on the event loop and wait for its result
+std::string IPC::run_on_loop(std::function<std::string()> task) {
+    if (!wake_source)
+        return "";
+
+    std::packaged_task<std::string()> packaged(std::move(task));
+    std::future<std::string> result = packaged.get_future();
+    {
+        // no event loop runs tasks queued after stopping
+        std::lock_guard lock(tasks_mutex);
+        if (!running)
+            return "";
+        tasks.emplace_back(std::move(packaged));
+    }
+
+    // wake the event loop
+    const uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) == -1)
+        wlr_log(WLR_ERROR, "failed to wake the event loop for an IPC task");
+
+    // tasks dropped by stop break their promise
+    try {
+        return result.get();
+    } catch (const std::future_error &) {
+        return "";
+    }
+}
+
+// run the queued tasks, called on the event loop
+void IPC::run_tasks() {
+    uint64_t count;
+    while (read(wake_fd, &count, sizeof(count)) > 0)
+        ;
+
+    std::deque<std::packaged_task<std::string()>> pending;
+    {
+        std::lock_guard lock(tasks_mutex);
+        pending.swap(tasks);
+    }
+
+    for (std::packaged_task<std::string()> &task : pending)
+        task();
+}
+
+// stop serving, safe to call from any thread and more than once
 void IPC::stop() {
-    // stop thread
-    running = false;
-    pthread_cancel(thread.native_handle());
+    std::deque<std::packaged_task<std::string()>> abandoned;
+    {
+        std::lock_guard lock(tasks_mutex);
+        running = false;
+        abandoned.swap(tasks);
+    }
+
+    // release a request waiting on the event loop with an empty response,
+    // the loop may already be gone
+    abandoned.clear();
+
+    // wake the thread from accept
+    if (fd != -1)
+        shutdown(fd, SHUT_RDWR);
+}
+
+IPC::~IPC() {
+    stop();
     if (thread.joinable())
         thread.join();
 
+    // stop waking the event loop
+    if (wake_source)
+        wl_event_source_remove(wake_source);
+    if (wake_fd != -1)
+        close(wake_fd);
+
     // close
-    close(fd);
+    if (fd != -1)
+        close(fd);
 
     // unlink
     if (unlink(path.c_str()))
         wlr_log(WLR_ERROR, "failed to unlink IPC socket at path `%s`",
                 path.c_str());
-
-    delete this;
 }
@@ -0,0 +1,41 @@
+#include "Server.h"
+
+IdleInhibitor::IdleInhibitor(Server *server, wlr_idle_inhibitor_v1 *inhibitor)
+    : server(server), inhibitor(inhibitor) {
+    wl_list_insert(&server->idle_inhibitors, &link);
+
+    // destroy
+    destroy.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
+        IdleInhibitor *inhibitor = wl_container_of(listener, inhibitor, destroy);
+        delete inhibitor;
+    };
+    wl_signal_add(&inhibitor->events.destroy, &destroy);
+
+    server->schedule_visibility();
+}
+
+IdleInhibitor::~IdleInhibitor() {
+    wl_list_remove(&destroy.link);
+    wl_list_remove(&link);
+
+    server->schedule_visibility();
+}
+
+// returns true if the inhibiting surface can be seen on a powered output
+bool IdleInhibitor::visible() const {
+    wlr_surface *surface = inhibitor->surface;
+    if (!surface->mapped)
+        return false;
+
+    // toplevels know if they are hidden, minimized or covered
+    if (const Toplevel *toplevel =
+            server->get_toplevel(wlr_surface_get_root_surface(surface));
+        toplevel && toplevel->suspended)
+        return false;
+
+    wlr_surface_output *surface_output;
+    wl_list_for_each(surface_output, &surface->current_outputs,
+                     link) if (surface_output->output->enabled) return true;
+
+    return false;
+}
@@ -0,0 +1,101 @@
+#include "Server.h"
+
+InputRecorder::InputRecorder(const std::string &path)
+    : file(fopen(path.c_str(), "wb")) {
+    if (!file) {
+        wlr_log(WLR_ERROR, "failed to open input recording `%s`", path.c_str());
+        return;
+    }
+
+    fwrite(recording_magic, sizeof(recording_magic), 1, file);
+    wlr_log(WLR_INFO, "recording input to `%s`", path.c_str());
+}
+
+InputRecorder::~InputRecorder() {
+    if (!file)
+        return;
+
+    fclose(file);
+    wlr_log(WLR_INFO, "recorded %lu input events",
+            static_cast<unsigned long>(events));
+}
+
+// stamp an event and append it to the recording, stdio buffers the writes
+void InputRecorder::record(RecordedEvent event) {
+    if (!file)
+        return;
+
+    const int64_t now = get_time_nsec();
+    if (!events)
+        start_ns = now;
+    event.time_ns = now - start_ns;
+
+    fwrite(&event, sizeof(event), 1, file);
+    ++events;
+}
+
+void InputRecorder::key(const wlr_keyboard_key_event *event) {
+    record({
+        .time_ns = 0,
+        .type = RecordedEvent::KEY,
+        .state = static_cast<uint8_t>(event->state),
+        .direction = 0,
+        .reserved = 0,
+        .code = event->keycode,
+        .values = {},
+    });
+}
+
+void InputRecorder::motion(const wlr_pointer_motion_event *event) {
+    record({
+        .time_ns = 0,
+        .type = RecordedEvent::MOTION,
+        .state = 0,
+        .direction = 0,
+        .reserved = 0,
+        .code = 0,
+        .values = {static_cast<float>(event->delta_x),
+                   static_cast<float>(event->delta_y),
+                   static_cast<float>(event->unaccel_dx),
+                   static_cast<float>(event->unaccel_dy)},
+    });
+}
+
+void InputRecorder::motion_absolute(
+    const wlr_pointer_motion_absolute_event *event) {
+    record({
+        .time_ns = 0,
+        .type = RecordedEvent::MOTION_ABSOLUTE,
+        .state = 0,
+        .direction = 0,
+        .reserved = 0,
+        .code = 0,
+        .values = {static_cast<float>(event->x), static_cast<float>(event->y),
+                   0, 0},
+    });
+}
+
+void InputRecorder::button(const wlr_pointer_button_event *event) {
+    record({
+        .time_ns = 0,
+        .type = RecordedEvent::BUTTON,
+        .state = static_cast<uint8_t>(event->state),
+        .direction = 0,
+        .reserved = 0,
+        .code = event->button,
+        .values = {},
+    });
+}
+
+void InputRecorder::axis(const wlr_pointer_axis_event *event) {
+    record({
+        .time_ns = 0,
+        .type = RecordedEvent::AXIS,
+        .state = static_cast<uint8_t>(event->source),
+        .direction = static_cast<uint8_t>(event->relative_direction),
+        .reserved = 0,
+        .code = static_cast<uint32_t>(event->orientation),
+        .values = {static_cast<float>(event->delta),
+                   static_cast<float>(event->delta_discrete), 0, 0},
+    });
+}
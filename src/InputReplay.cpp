@@ -0,0 +1,328 @@
+#include "Server.h"
+#include <cstring>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+// events without a frame showing their effect after this long never get one
+static constexpr int64_t effect_timeout_ns = 1000000000;
+
+static const wlr_keyboard_impl keyboard_impl = {
+    .name = "awm-replay-keyboard",
+    .led_update = nullptr,
+};
+
+static const wlr_pointer_impl pointer_impl = {
+    .name = "awm-replay-pointer",
+};
+
+InputReplay::InputReplay(Server *server, const std::string &path,
+                         const double speed)
+    : server(server), path(path), speed(speed > 0 ? speed : 1.0) {
+    // inject the next due events
+    timer = wl_event_loop_add_timer(
+        wl_display_get_event_loop(server->display),
+        [](void *data) {
+            static_cast<InputReplay *>(data)->inject_due();
+            return 0;
+        },
+        this);
+
+    wlr_keyboard_init(&keyboard, &keyboard_impl, keyboard_impl.name);
+    wlr_pointer_init(&pointer, &pointer_impl, pointer_impl.name);
+}
+
+ReplayTarget::ReplayTarget(InputReplay *replay, wlr_surface *surface)
+    : replay(replay), surface(surface) {
+    // commit
+    commit.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
+        ReplayTarget *target = wl_container_of(listener, target, commit);
+        target->replay->surface_committed(target->surface);
+    };
+    wl_signal_add(&surface->events.commit, &commit);
+
+    // destroy
+    destroy.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
+        ReplayTarget *target = wl_container_of(listener, target, destroy);
+        target->replay->surface_destroyed(target->surface);
+    };
+    wl_signal_add(&surface->events.destroy, &destroy);
+}
+
+ReplayTarget::~ReplayTarget() {
+    wl_list_remove(&commit.link);
+    wl_list_remove(&destroy.link);
+}
+
+InputReplay::~InputReplay() {
+    for (const auto &[surface, target] : targets)
+        delete target;
+
+    wl_event_source_remove(timer);
+    wlr_pointer_finish(&pointer);
+    wlr_keyboard_finish(&keyboard);
+}
+
+// read the recording
+bool InputReplay::load() {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        wlr_log(WLR_ERROR, "failed to open input recording `%s`", path.c_str());
+        return false;
+    }
+
+    char magic[sizeof(recording_magic)];
+    if (fread(magic, sizeof(magic), 1, file) != 1 ||
+        memcmp(magic, recording_magic, sizeof(magic)) != 0) {
+        wlr_log(WLR_ERROR, "`%s` is not an input recording", path.c_str());
+        fclose(file);
+        return false;
+    }
+
+    RecordedEvent event{};
+    while (fread(&event, sizeof(event), 1, file) == 1)
+        if (event.type <= RecordedEvent::AXIS)
+            events.emplace_back(event);
+    fclose(file);
+
+    wlr_log(WLR_INFO, "replaying %zu input events from `%s` at %.2fx",
+            events.size(), path.c_str(), speed);
+    return true;
+}
+
+// announce the virtual devices and start injecting
+void InputReplay::start() {
+    wl_signal_emit_mutable(&server->backend->events.new_input, &keyboard.base);
+    wl_signal_emit_mutable(&server->backend->events.new_input, &pointer.base);
+
+    // the replay starts once the event loop runs
+    wl_event_source_timer_update(timer, 1);
+}
+
+// inject every event that is due and wait for the next one
+void InputReplay::inject_due() {
+    const int64_t now = get_time_nsec();
+    if (!start_ns)
+        start_ns = now;
+    expire(now);
+
+    while (next != events.size() &&
+           start_ns + static_cast<int64_t>(events[next].time_ns / speed) <=
+               now)
+        inject(events[next++]);
+
+    // wait for the last effects to show before reporting
+    if (next == events.size()) {
+        if (pending.empty() && !finished)
+            report();
+        else
+            wl_event_source_timer_update(timer, 100);
+        return;
+    }
+
+    const int64_t due =
+        start_ns + static_cast<int64_t>(events[next].time_ns / speed);
+    wl_event_source_timer_update(
+        timer, static_cast<int>(std::max<int64_t>((due - now) / 1000000, 1)));
+}
+
+// inject a single event through the virtual devices
+void InputReplay::inject(const RecordedEvent &event) {
+    const int64_t now = get_time_nsec();
+    const auto time_msec = static_cast<uint32_t>(now / 1000000);
+
+    switch (event.type) {
+    case RecordedEvent::KEY: {
+        wlr_keyboard_key_event key{
+            .time_msec = time_msec,
+            .keycode = event.code,
+            .update_state = true,
+            .state = static_cast<wl_keyboard_key_state>(event.state),
+        };
+        wlr_keyboard_notify_key(&keyboard, &key);
+        break;
+    }
+    case RecordedEvent::MOTION: {
+        wlr_pointer_motion_event motion{
+            .pointer = &pointer,
+            .time_msec = time_msec,
+            .delta_x = event.values[0],
+            .delta_y = event.values[1],
+            .unaccel_dx = event.values[2],
+            .unaccel_dy = event.values[3],
+        };
+        wl_signal_emit_mutable(&pointer.events.motion, &motion);
+        wl_signal_emit_mutable(&pointer.events.frame, &pointer);
+        break;
+    }
+    case RecordedEvent::MOTION_ABSOLUTE: {
+        wlr_pointer_motion_absolute_event motion{
+            .pointer = &pointer,
+            .time_msec = time_msec,
+            .x = event.values[0],
+            .y = event.values[1],
+        };
+        wl_signal_emit_mutable(&pointer.events.motion_absolute, &motion);
+        wl_signal_emit_mutable(&pointer.events.frame, &pointer);
+        break;
+    }
+    case RecordedEvent::BUTTON: {
+        wlr_pointer_button_event button{
+            .pointer = &pointer,
+            .time_msec = time_msec,
+            .button = event.code,
+            .state = static_cast<wl_pointer_button_state>(event.state),
+        };
+        wl_signal_emit_mutable(&pointer.events.button, &button);
+        wl_signal_emit_mutable(&pointer.events.frame, &pointer);
+        break;
+    }
+    case RecordedEvent::AXIS: {
+        wlr_pointer_axis_event axis{
+            .pointer = &pointer,
+            .time_msec = time_msec,
+            .source = static_cast<wl_pointer_axis_source>(event.state),
+            .orientation = static_cast<wl_pointer_axis>(event.code),
+            .relative_direction =
+                static_cast<wl_pointer_axis_relative_direction>(
+                    event.direction),
+            .delta = event.values[0],
+            .delta_discrete = static_cast<int32_t>(event.values[1]),
+        };
+        wl_signal_emit_mutable(&pointer.events.axis, &axis);
+        wl_signal_emit_mutable(&pointer.events.frame, &pointer);
+        break;
+    }
+    }
+
+    // the client that should respond, after focus followed the event
+    const wlr_seat *seat = server->seat;
+    wlr_surface *target = event.type == RecordedEvent::KEY
+                              ? seat->keyboard_state.focused_surface
+                              : seat->pointer_state.focused_surface;
+    if (!target) {
+        ++untargeted;
+        return;
+    }
+
+    wlr_surface *root = wlr_surface_get_root_surface(target);
+    pending.push_back({
+        .injected_ns = now,
+        .type = event.type,
+        .target = root,
+        .committed_ns = 0,
+        .outputs = {},
+    });
+
+    // wait for the next commit of the target
+    if (!targets.count(root))
+        targets[root] = new ReplayTarget(this, root);
+}
+
+// the first commit of a target after injection carries the event's effect,
+// the target is not watched further until another event is sent to it
+void InputReplay::surface_committed(wlr_surface *surface) {
+    const int64_t now = get_time_nsec();
+
+    for (PendingInput &input : pending) {
+        if (input.committed_ns || input.target != surface)
+            continue;
+
+        input.committed_ns = now;
+        wlr_surface_output *surface_output;
+        wl_list_for_each(surface_output, &surface->current_outputs, link)
+            input.outputs.emplace_back(surface_output->output);
+    }
+
+    if (const auto it = targets.find(surface); it != targets.end()) {
+        delete it->second;
+        targets.erase(it);
+    }
+}
+
+// a target went away before committing, its events expire unresolved
+void InputReplay::surface_destroyed(const wlr_surface *surface) {
+    for (PendingInput &input : pending)
+        if (input.target == surface)
+            input.target = nullptr;
+
+    if (const auto it = targets.find(surface); it != targets.end()) {
+        delete it->second;
+        targets.erase(it);
+    }
+}
+
+// a frame of the output rendered at render_start_ns was presented, it shows
+// the effect of every event whose commit it rendered
+void InputReplay::frame_presented(const wlr_output *output,
+                                  const int64_t render_start_ns,
+                                  const int64_t present_ns) {
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (!it->committed_ns || it->committed_ns >= render_start_ns ||
+            std::find(it->outputs.begin(), it->outputs.end(), output) ==
+                it->outputs.end()) {
+            ++it;
+            continue;
+        }
+
+        latencies[it->type].emplace_back(present_ns - it->injected_ns);
+        it = pending.erase(it);
+    }
+}
+
+// give up on events whose effect never showed
+void InputReplay::expire(const int64_t now) {
+    while (!pending.empty() &&
+           now - pending.front().injected_ns > effect_timeout_ns) {
+        pending.pop_front();
+        ++unresolved;
+    }
+}
+
+// print the latency report and stop a headless instance
+void InputReplay::report() {
+    finished = true;
+
+    const char *names[] = {"key", "motion", "motion_absolute", "button",
+                           "axis"};
+    json j = {
+        {"recording", path},
+        {"speed", speed},
+        {"events", events.size()},
+        {"unresolved", unresolved},
+        {"untargeted", untargeted},
+    };
+
+    std::vector<int64_t> all;
+    for (size_t type = 0; type != std::size(latencies); ++type) {
+        std::vector<int64_t> &samples = latencies[type];
+        all.insert(all.end(), samples.begin(), samples.end());
+        if (samples.empty())
+            continue;
+
+        std::sort(samples.begin(), samples.end());
+        j["latency_ms"][names[type]] = {
+            {"p50", samples[(samples.size() - 1) / 2] / 1e6},
+            {"p90", samples[(samples.size() - 1) * 9 / 10] / 1e6},
+            {"p99", samples[(samples.size() - 1) * 99 / 100] / 1e6},
+            {"max", samples.back() / 1e6},
+            {"samples", samples.size()},
+        };
+    }
+
+    if (!all.empty()) {
+        std::sort(all.begin(), all.end());
+        j["latency_ms"]["all"] = {
+            {"p50", all[(all.size() - 1) / 2] / 1e6},
+            {"p90", all[(all.size() - 1) * 9 / 10] / 1e6},
+            {"p99", all[(all.size() - 1) * 99 / 100] / 1e6},
+            {"max", all.back() / 1e6},
+            {"samples", all.size()},
+        };
+    }
+
+    printf("%s\n", j.dump(4).c_str());
+    fflush(stdout);
+
+    if (server->config->bench.enabled)
+        server->exit();
+}
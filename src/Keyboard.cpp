@@ -3,6 +3,8 @@
 // execute either a wm bind or command bind, returns true if
 // bind is valid, false otherwise
 bool Keyboard::handle_bind(const Bind bind) {
+    TraceSpan span("handle_bind");
+
     // retrieve config
     Config *config = server->config;
 
@@ -13,11 +15,13 @@ bool Keyboard::handle_bind(const Bind bind) {
 
     // handle user-defined binds
     for (const auto &[cmd_bind, cmd] : config->commands)
-        if (cmd_bind == bind)
+        if (cmd_bind == bind) {
             if (fork() == 0) {
                 execl("/bin/sh", "/bin/sh", "-c", cmd.c_str(), nullptr);
                 return true;
             }
+            ++server->metrics.spawned_processes;
+        }
 
     // handle compositor binds
     if (bind == config->exit) {
@@ -44,23 +48,23 @@ bool Keyboard::handle_bind(const Bind bind) {
     } else if (bind == config->window_up) {
         // focus the toplevel in the up direction
         if (Toplevel *up = output->get_active()->in_direction(WLR_DIRECTION_UP))
-            output->get_active()->focus_toplevel(up);
+            server->focus_toplevel(up);
     } else if (bind == config->window_down) {
         // focus the toplevel in the down direction
         if (Toplevel *down =
                 output->get_active()->in_direction(WLR_DIRECTION_DOWN))
-            output->get_active()->focus_toplevel(down);
+            server->focus_toplevel(down);
     } else if (bind == config->window_left) {
         // focus the toplevel in the left direction
         if (Toplevel *left =
                 output->get_active()->in_direction(WLR_DIRECTION_LEFT))
-            output->get_active()->focus_toplevel(left);
+            server->focus_toplevel(left);
     } else if (bind == config->window_right) {
         // focus the toplevel in the right direction
         Toplevel *right =
             output->get_active()->in_direction(WLR_DIRECTION_RIGHT);
         if (right)
-            output->get_active()->focus_toplevel(right);
+            server->focus_toplevel(right);
     } else if (bind == config->window_close) {
         // close the active toplevel
         output->get_active()->close_active();
@@ -211,6 +215,10 @@ Keyboard::Keyboard(Server *server, wlr_input_device *device)
         const Server *server = keyboard->server;
         const auto *event = static_cast<wlr_keyboard_key_event *>(data);
         wlr_seat *seat = server->seat;
+        server->notify_activity();
+        if (server->records(&keyboard->wlr_keyboard->base))
+            server->input_recorder->key(event);
+        ++keyboard->server->metrics.key_events;
 
         // libinput keycode -> xkbcommon
         const uint32_t keycode = event->keycode + 8;
@@ -241,6 +249,8 @@ Keyboard::Keyboard(Server *server, wlr_input_device *device)
                         Bind{modifiers, syms_translated[i]});
         }
 
+        AWM_PROBE(key_bind, event->keycode, event->state, handled);
+
         if (!handled) {
             // send unhandled key presses to seat
             wlr_seat_set_keyboard(seat, keyboard->wlr_keyboard);
@@ -0,0 +1,51 @@
+#include "Layout.h"
+#include <cmath>
+
+// returns true if outer fully contains inner
+bool box_contains(const Box &outer, const Box &inner) {
+    return !inner.empty() && inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+// split an area into a grid of count cells, as square as possible, filled
+// row by row
+std::vector<Box> tile_grid(const Box &area, const size_t count) {
+    std::vector<Box> cells;
+    if (!count)
+        return cells;
+
+    // calculate rows and cols from the count
+    const int rows =
+        static_cast<int>(std::round(std::sqrt(static_cast<double>(count))));
+    const int cols = (static_cast<int>(count) + rows - 1) / rows;
+
+    // width and height is just the fraction of the area
+    const int width = area.width / cols;
+    const int height = area.height / rows;
+
+    cells.reserve(count);
+    for (size_t i = 0; i != count; ++i) {
+        const int row = static_cast<int>(i) / cols;
+        const int col = static_cast<int>(i) % cols;
+        cells.push_back(
+            {area.x + col * width, area.y + row * height, width, height});
+    }
+
+    return cells;
+}
+
+// get the link after or before current in a list, wrapping around at the
+// ends, returns nullptr if there is nothing else to move to
+wl_list *focus_step(const wl_list *list, const wl_list *current,
+                    const bool forward) {
+    // fewer than two entries
+    if (list->next == list->prev)
+        return nullptr;
+
+    wl_list *step = forward ? current->next : current->prev;
+    if (step == list)
+        step = forward ? list->next : list->prev;
+
+    return step;
+}
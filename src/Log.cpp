@@ -0,0 +1,226 @@
+#include "Server.h"
+#include <csignal>
+
+LogSink *LogSink::instance = nullptr;
+
+static constexpr int fatal_signals[] = {SIGABRT, SIGBUS, SIGFPE, SIGILL,
+                                        SIGSEGV};
+
+// format a published line without allocating, returns its length
+static size_t format_line(const LogSlot &slot, const int64_t start_ns,
+                          char *buffer, const size_t size) {
+    static const char *names[] = {"SILENT", "ERROR", "INFO", "DEBUG"};
+
+    const int64_t ms = (slot.time_ns - start_ns) / 1000000;
+    int length = snprintf(
+        buffer, size, "%02ld:%02ld:%02ld.%03ld [%s] %s", ms / 3600000,
+        ms / 60000 % 60, ms / 1000 % 60, ms % 1000,
+        names[std::min<size_t>(slot.importance, std::size(names) - 1)],
+        slot.text);
+
+    // mark lines cut to fit their slot
+    if (slot.truncated && length >= 0 && static_cast<size_t>(length) < size)
+        length += snprintf(buffer + length, size - length,
+                           " [truncated %u bytes]", slot.truncated);
+
+    return std::min<size_t>(std::max(length, 0), size - 1);
+}
+
+LogSink::LogSink(const wlr_log_importance level)
+    : start_ns(get_time_nsec()), level(level) {
+    for (size_t i = 0; i != size; ++i)
+        slots[i].seq.store(i, std::memory_order_relaxed);
+
+    instance = this;
+    set_level(level);
+
+    // write out what is left in the ring before dying
+    struct sigaction sa{};
+    sa.sa_handler = [](const int sig) {
+        if (instance)
+            instance->flush_fatal();
+        raise(sig);
+    };
+    sa.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    for (const int sig : fatal_signals)
+        sigaction(sig, &sa, nullptr);
+
+    // write lines out in batches
+    thread = std::thread([this]() {
+        while (running) {
+            flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        flush();
+    });
+}
+
+LogSink::~LogSink() {
+    running = false;
+    if (thread.joinable())
+        thread.join();
+
+    wlr_log_init(level, nullptr);
+    for (const int sig : fatal_signals)
+        signal(sig, SIG_DFL);
+    instance = nullptr;
+
+    if (file != stderr)
+        fclose(file);
+}
+
+// change the level, before other threads log
+void LogSink::set_level(const wlr_log_importance level) {
+    this->level = level;
+    wlr_log_init(level, [](const wlr_log_importance importance,
+                           const char *fmt, va_list args) {
+        instance->push(importance, fmt, args);
+    });
+}
+
+// write lines to a file instead of stderr
+bool LogSink::open(const std::string &path) {
+    FILE *opened = fopen(path.c_str(), "a");
+    if (!opened) {
+        wlr_log(WLR_ERROR, "failed to open log file `%s`", path.c_str());
+        return false;
+    }
+
+    // swapped by the writer so no line is lost in between
+    std::lock_guard lock(history_mutex);
+    FILE *previous = file;
+    file = opened;
+    if (previous != stderr)
+        fclose(previous);
+    return true;
+}
+
+// format a line into the next free slot, dropping it if the ring is full.
+// errors are written out before returning
+void LogSink::push(const wlr_log_importance importance, const char *fmt,
+                   va_list args) {
+    if (importance > level)
+        return;
+
+    const bool error = importance == WLR_ERROR;
+    bool flushed = false;
+
+    uint64_t index = write_index.load(std::memory_order_relaxed);
+    LogSlot *slot;
+    while (true) {
+        slot = &slots[index % size];
+        const uint64_t seq = slot->seq.load(std::memory_order_acquire);
+
+        if (seq == index) {
+            // claim the slot
+            if (write_index.compare_exchange_weak(index, index + 1,
+                                                  std::memory_order_relaxed))
+                break;
+        } else if (seq < index) {
+            // the writer has not caught up, make room for an error once
+            if (!error || flushed) {
+                ++dropped;
+                return;
+            }
+            flush();
+            flushed = true;
+            index = write_index.load(std::memory_order_relaxed);
+        } else
+            index = write_index.load(std::memory_order_relaxed);
+    }
+
+    slot->time_ns = get_time_nsec();
+    slot->importance = importance;
+    const int length = vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    slot->truncated =
+        length >= static_cast<int>(sizeof(slot->text))
+            ? static_cast<uint32_t>(length - (sizeof(slot->text) - 1))
+            : 0;
+    slot->seq.store(index + 1, std::memory_order_release);
+
+    if (error)
+        flush();
+}
+
+// write out every published line, called by the writer thread
+void LogSink::flush() {
+    std::lock_guard lock(history_mutex);
+    bool written = false;
+
+    while (true) {
+        LogSlot &slot = slots[read_index % size];
+        if (slot.seq.load(std::memory_order_acquire) != read_index + 1)
+            break;
+
+        char buffer[512];
+        std::string line(buffer,
+                         format_line(slot, start_ns, buffer, sizeof(buffer)));
+
+        slot.seq.store(read_index + size, std::memory_order_release);
+        ++read_index;
+
+        fprintf(file, "%s\n", line.c_str());
+        written = true;
+
+        history.emplace_back(std::move(line));
+        if (history.size() > history_size)
+            history.pop_front();
+    }
+
+    // report lines lost to a full ring
+    if (const uint64_t lost = dropped.exchange(0)) {
+        fprintf(file, "dropped %lu log lines\n",
+                static_cast<unsigned long>(lost));
+        written = true;
+    }
+
+    if (written)
+        fflush(file);
+}
+
+// write out every published line from a fatal signal handler, without
+// allocating. skipped if the ring is being written out, as the lock holder
+// may be the thread that crashed
+void LogSink::flush_fatal() {
+    if (!history_mutex.try_lock())
+        return;
+
+    while (true) {
+        LogSlot &slot = slots[read_index % size];
+        if (slot.seq.load(std::memory_order_acquire) != read_index + 1)
+            break;
+
+        char buffer[512];
+        const size_t length =
+            format_line(slot, start_ns, buffer, sizeof(buffer));
+        buffer[length] = '\n';
+        fwrite(buffer, 1, length + 1, file);
+        ++read_index;
+    }
+
+    fflush(file);
+    history_mutex.unlock();
+}
+
+// the latest written lines, oldest first
+std::vector<std::string> LogSink::tail(const size_t count) {
+    std::lock_guard lock(history_mutex);
+    const size_t n = std::min(count, history.size());
+    return {history.end() - static_cast<std::ptrdiff_t>(n), history.end()};
+}
+
+// parse a log level name
+bool parse_log_level(const std::string &name, wlr_log_importance *level) {
+    if (name == "silent")
+        *level = WLR_SILENT;
+    else if (name == "error")
+        *level = WLR_ERROR;
+    else if (name == "info")
+        *level = WLR_INFO;
+    else if (name == "debug")
+        *level = WLR_DEBUG;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,148 @@
+#include "Server.h"
+
+Histogram::Histogram(const std::initializer_list<double> bounds)
+    : bounds(bounds), buckets(bounds.size()) {}
+
+// count a duration in the first bucket it fits
+void Histogram::observe(const int64_t ns) {
+    const double seconds = ns / 1e9;
+    for (size_t i = 0; i != bounds.size(); ++i)
+        if (seconds <= bounds[i]) {
+            buckets[i].fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+// append the histogram series, buckets are cumulative in the text format
+void Histogram::expose(std::string &out, const std::string &name,
+                       const std::string &labels) const {
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i != bounds.size(); ++i) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        out += string_format("%s_bucket{%sle=\"%g\"} %lu\n", name.c_str(),
+                             prefix.c_str(), bounds[i], cumulative);
+    }
+
+    const uint64_t total = count.load(std::memory_order_relaxed);
+    const std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out += string_format("%s_bucket{%sle=\"+Inf\"} %lu\n", name.c_str(),
+                         prefix.c_str(), total);
+    out += string_format("%s_sum%s %.9f\n", name.c_str(), braces.c_str(),
+                         sum_ns.load(std::memory_order_relaxed) / 1e9);
+    out += string_format("%s_count%s %lu\n", name.c_str(), braces.c_str(),
+                         total);
+}
+
+// help and type lines of a metric
+static void header(std::string &out, const char *name, const char *type,
+                   const char *help) {
+    out += string_format("# HELP %s %s\n# TYPE %s %s\n", name, help, name,
+                         type);
+}
+
+// all metrics in prometheus text format, called on the event loop
+std::string Metrics::expose(const Server *server) const {
+    std::string out;
+    const wl_list *outputs = &server->output_manager->outputs;
+    Output *output;
+
+    header(out, "awm_frames_total", "counter",
+           "Frames by output and result.");
+    wl_list_for_each(output, outputs, link) {
+        const char *name = output->wlr_output->name;
+        const std::pair<const char *, uint64_t> results[] = {
+            {"presented", output->frames_presented},
+            {"discarded", output->frames_discarded},
+            {"empty", output->frames_empty},
+        };
+        for (const auto &[result, value] : results)
+            out += string_format(
+                "awm_frames_total{output=\"%s\",result=\"%s\"} %lu\n", name,
+                result, value);
+    }
+
+    header(out, "awm_missed_vblanks_total", "counter",
+           "Vblanks missed by late commits.");
+    wl_list_for_each(output, outputs, link) {
+        out += string_format("awm_missed_vblanks_total{output=\"%s\"} %lu\n",
+                             output->wlr_output->name, output->frames_missed);
+    }
+
+    header(out, "awm_commit_duration_seconds", "histogram",
+           "Scene commit duration of rendered frames.");
+    wl_list_for_each(output, outputs, link) {
+        output->commit_histogram.expose(
+            out, "awm_commit_duration_seconds",
+            string_format("output=\"%s\"", output->wlr_output->name));
+    }
+
+    // mapped toplevels and layer surfaces by output and workspace
+    std::string surfaces, toplevels;
+    uint64_t xwayland_surfaces = 0;
+    wl_list_for_each(output, outputs, link) {
+        uint64_t count = 0;
+
+        Workspace *workspace;
+        wl_list_for_each(workspace, &output->workspaces, link) {
+            const int n = wl_list_length(&workspace->toplevels);
+            toplevels += string_format(
+                "awm_toplevels{output=\"%s\",workspace=\"%u\"} %d\n",
+                output->wlr_output->name, workspace->num, n);
+            count += n;
+
+#ifdef XWAYLAND
+            Toplevel *toplevel;
+            wl_list_for_each(toplevel, &workspace->toplevels, link) {
+                if (toplevel->xwayland_surface)
+                    ++xwayland_surfaces;
+            }
+#endif
+        }
+
+        LayerSurface *layer_surface;
+        wl_list_for_each(layer_surface, &server->layer_surfaces, link) {
+            if (layer_surface->output == output)
+                ++count;
+        }
+
+        surfaces += string_format("awm_surfaces{output=\"%s\"} %lu\n",
+                                  output->wlr_output->name, count);
+    }
+
+    header(out, "awm_surfaces", "gauge",
+           "Toplevels and layer surfaces by output.");
+    out += surfaces;
+    header(out, "awm_toplevels", "gauge", "Toplevels by workspace.");
+    out += toplevels;
+    header(out, "awm_xwayland_surfaces", "gauge", "Xwayland toplevels.");
+    out += string_format("awm_xwayland_surfaces %lu\n", xwayland_surfaces);
+
+    const struct {
+        const char *name;
+        const char *help;
+        uint64_t value;
+    } counters[] = {
+        {"awm_key_events_total", "Keyboard key events.", key_events.load()},
+        {"awm_spawned_processes_total", "Processes spawned for commands.",
+         spawned_processes.load()},
+        {"awm_config_reloads_total", "Successful config reloads.",
+         config_reloads.load()},
+        {"awm_ipc_requests_total", "IPC requests served.",
+         ipc_requests.load()},
+    };
+    for (const auto &counter : counters) {
+        header(out, counter.name, "counter", counter.help);
+        out += string_format("%s %lu\n", counter.name, counter.value);
+    }
+
+    header(out, "awm_ipc_duration_seconds", "histogram",
+           "Time to serve an IPC request.");
+    ipc_duration.expose(out, "awm_ipc_duration_seconds", "");
+
+    return out;
+}
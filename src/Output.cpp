@@ -28,23 +28,68 @@ Output::Output(Server *server, struct wlr_output *wlr_output)
     frame.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
         // called once per frame
         Output *output = wl_container_of(listener, output, frame);
-        wlr_scene *scene = output->server->scene;
 
-        wlr_scene_output *scene_output =
-            wlr_scene_get_scene_output(scene, output->wlr_output);
+        // the virtual clock drives frames instead of the backend
+        if (output->virtual_timer)
+            return;
 
-        // render scene
-        wlr_scene_output_commit(scene_output, nullptr);
+        output->last_frame_ns = get_time_nsec();
 
-        // get frame time
-        timespec now{};
-        clock_gettime(CLOCK_MONOTONIC, &now);
-        wlr_scene_output_send_frame_done(scene_output, &now);
-
-        // output->arrange_layers();
+        // render now or just before the next vblank
+        output->schedule_render();
     };
     wl_signal_add(&wlr_output->events.frame, &frame);
 
+    // the virtual clock starts from now on the monotonic clock frame done is
+    // stamped with, and renders a frame on each of its vblanks
+    if (server->config->bench.virtual_clock) {
+        virtual_vblank_ns = get_time_nsec();
+        virtual_timer = wl_event_loop_add_timer(
+            wl_display_get_event_loop(server->display),
+            [](void *data) {
+                static_cast<Output *>(data)->virtual_frame();
+                return 0;
+            },
+            this);
+        schedule_virtual_frame();
+    }
+
+    // present
+    present.notify = [](wl_listener *listener, void *data) {
+        Output *output = wl_container_of(listener, output, present);
+        output->record_present(static_cast<wlr_output_event_present *>(data));
+    };
+    wl_signal_add(&wlr_output->events.present, &present);
+
+    // render once the scheduled delay has passed
+    render_timer = wl_event_loop_add_timer(
+        wl_display_get_event_loop(server->display),
+        [](void *data) {
+            Output *output = static_cast<Output *>(data);
+            output->render();
+            return 0;
+        },
+        this);
+
+    // schedule a frame once throttled surfaces are due a frame done
+    frame_done_timer = wl_event_loop_add_timer(
+        wl_display_get_event_loop(server->display),
+        [](void *data) {
+            const Output *output = static_cast<Output *>(data);
+            wlr_output_schedule_frame(output->wlr_output);
+            return 0;
+        },
+        this);
+
+    // downshift the refresh rate once idle
+    idle_timer = wl_event_loop_add_timer(
+        wl_display_get_event_loop(server->display),
+        [](void *data) {
+            static_cast<Output *>(data)->check_idle();
+            return 0;
+        },
+        this);
+
     // request_state
     request_state.notify = [](wl_listener *listener, void *data) {
         Output *output = wl_container_of(listener, output, request_state);
@@ -65,15 +110,702 @@ Output::Output(Server *server, struct wlr_output *wlr_output)
 }
 
 Output::~Output() {
+    // cancel a move grab homed on this output
+    if (server->cursor && server->cursor->grab_output == this)
+        server->cursor->reset_mode();
+
     Workspace *workspace, *tmp;
     wl_list_for_each_safe(workspace, tmp, &workspaces, link) delete workspace;
 
+    wl_event_source_remove(frame_done_timer);
+    wl_event_source_remove(render_timer);
+    wl_event_source_remove(idle_timer);
+    if (virtual_timer)
+        wl_event_source_remove(virtual_timer);
+
     wl_list_remove(&frame.link);
+    wl_list_remove(&present.link);
     wl_list_remove(&request_state.link);
     wl_list_remove(&destroy.link);
     wl_list_remove(&link);
 }
 
+// render the scene to the output and send frame done to its surfaces
+void Output::render() {
+    render_pending = false;
+
+    // powered off
+    if (!wlr_output->enabled)
+        return;
+
+    AWM_PROBE(frame_begin, wlr_output->name);
+
+    // release timed commits due by the nearest vblank to this frame
+    const int64_t refresh_ns =
+        wlr_output->refresh > 0 ? 1000000000000ll / wlr_output->refresh : 0;
+    server->commit_timing_manager->output_rendering(
+        this, predicted_present_ns() + refresh_ns / 2);
+
+    // time commits that actually render something
+    const bool needs_frame = wlr_scene_output_needs_frame(scene_output);
+    const int64_t start = get_time_nsec();
+
+    // render scene
+    TraceSpan span("output_commit");
+    const bool committed = commit_scene(needs_frame && allows_tearing());
+
+    if (needs_frame && committed) {
+        const int64_t end = get_time_nsec();
+
+        commit_times[commit_times_next] = end - start;
+        commit_histogram.observe(end - start);
+        commit_times_next = (commit_times_next + 1) % commit_times.size();
+        commit_times_count =
+            std::min(commit_times_count + 1, commit_times.size());
+
+        // wait for the present event of this commit
+        commit_pending = true;
+        commit_seq = wlr_output->commit_seq;
+        commit_ns = end - start;
+        commit_end_ns = end;
+    } else if (!needs_frame)
+        // nothing was damaged
+        ++frames_empty;
+    AWM_PROBE(frame_end, wlr_output->name, needs_frame, committed);
+
+    // damage keeps the output at full refresh, except for the redraw caused
+    // by switching the refresh rate
+    if (needs_frame && get_time_nsec() >= idle_grace_ns)
+        notify_activity();
+
+    // this refresh latched the content behind any fifo barriers
+    server->fifo_manager->output_rendered(this);
+
+    // stamp frame done with the virtual vblank, the last presentation, or now
+    // if there is none
+    timespec when = last_present;
+    if (virtual_timer) {
+        when.tv_sec = virtual_vblank_ns / 1000000000ll;
+        when.tv_nsec = virtual_vblank_ns % 1000000000ll;
+    } else if (!last_present_ns)
+        clock_gettime(CLOCK_MONOTONIC, &when);
+    send_frame_done(&when);
+}
+
+// commit the scene to the output, with an async page flip if tearing is
+// requested and the backend supports it
+bool Output::commit_scene(const bool tearing) {
+    if (!tearing)
+        return wlr_scene_output_commit(scene_output, nullptr);
+
+    wlr_output_state state{};
+    wlr_output_state_init(&state);
+
+    bool success = wlr_scene_output_build_state(scene_output, &state, nullptr);
+    if (success) {
+        // fall back to a regular page flip if async ones are not supported
+        state.tearing_page_flip = true;
+        if (!wlr_output_test_state(wlr_output, &state)) {
+            wlr_log(WLR_DEBUG, "output %s can not tear, using vsync",
+                    wlr_output->name);
+            state.tearing_page_flip = false;
+        }
+
+        success = wlr_output_commit_state(wlr_output, &state);
+    }
+
+    wlr_output_state_finish(&state);
+    return success;
+}
+
+// returns true if the visible fullscreen toplevel of this output may tear
+bool Output::allows_tearing() const {
+    if (!allow_tearing || server->locked)
+        return false;
+
+    const Workspace *workspace = get_active();
+    const Toplevel *toplevel =
+        workspace ? workspace->fullscreen_toplevel() : nullptr;
+    if (!toplevel)
+        return false;
+
+    // window rule overrides the client
+    if (toplevel->tearing.has_value())
+        return *toplevel->tearing;
+
+    wlr_surface *surface = toplevel->get_surface();
+    return surface &&
+           wlr_tearing_control_manager_v1_surface_hint_from_surface(
+               server->wlr_tearing_control_manager, surface) ==
+               WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC;
+}
+
+// record the statistics of a presented or discarded frame
+void Output::record_present(const wlr_output_event_present *event) {
+    // only rendered frames are recorded
+    if (!commit_pending || event->commit_seq != commit_seq)
+        return;
+
+    commit_pending = false;
+
+    FrameStats stats{
+        .commit_ns = commit_ns,
+        .present_ns = 0,
+        .refresh_ns = event->refresh,
+        .missed = 0,
+    };
+
+    if (event->presented) {
+        ++frames_presented;
+
+        const timespec when = event->when;
+        stats.present_ns = when.tv_sec * 1000000000ll + when.tv_nsec;
+
+        // the commit should have made the first vblank after it finished
+        if (last_present_ns && stats.refresh_ns > 0 &&
+            commit_end_ns > last_present_ns) {
+            const int64_t refresh = stats.refresh_ns;
+            const int64_t expected =
+                last_present_ns +
+                (commit_end_ns - last_present_ns + refresh - 1) / refresh *
+                    refresh;
+
+            if (stats.present_ns > expected)
+                stats.missed = static_cast<uint32_t>(
+                    (stats.present_ns - expected + refresh / 2) / refresh);
+            frames_missed += stats.missed;
+        }
+
+        last_present = when;
+        last_present_ns = stats.present_ns;
+
+        // effects of replayed input are shown by this frame
+        if (server->input_replay)
+            server->input_replay->frame_presented(
+                wlr_output, commit_end_ns - commit_ns,
+                event->when.tv_sec * 1000000000ll + event->when.tv_nsec);
+    } else
+        ++frames_discarded;
+
+    frame_stats[frame_stats_next] = stats;
+    frame_stats_next = (frame_stats_next + 1) % frame_stats.size();
+    frame_stats_count = std::min(frame_stats_count + 1, frame_stats.size());
+}
+
+// render immediately, or delay rendering until the predicted render time and
+// safety margin before the next vblank so late client commits make the frame
+void Output::schedule_render() {
+    // delayed render already pending, or powered off
+    if (render_pending || !wlr_output->enabled)
+        return;
+
+    render_delay_ns = 0;
+
+    // tearing toplevels want their frame as soon as possible
+    const Config *config = server->config;
+    if (!config->render.schedule_frames || wlr_output->refresh <= 0 ||
+        !commit_times_count || allows_tearing()) {
+        render();
+        return;
+    }
+
+    // the frame event follows a vblank, so the next one is a refresh away
+    const int64_t refresh_ns = 1000000000000ll / wlr_output->refresh;
+    const int64_t delay_ns = refresh_ns - predicted_render_time() -
+                             config->render.safety_margin * 1000000;
+
+    // timers are in ms, not worth delaying for less
+    const int64_t delay_ms = delay_ns / 1000000;
+    if (delay_ms < 1) {
+        render();
+        return;
+    }
+
+    render_pending = true;
+    render_delay_ns = delay_ms * 1000000;
+    wl_event_source_timer_update(render_timer, static_cast<int>(delay_ms));
+}
+
+// advance the virtual clock by exactly one refresh and render on it
+void Output::virtual_frame() {
+    virtual_vblank_ns += virtual_refresh_ns();
+    last_frame_ns = virtual_vblank_ns;
+    render_delay_ns = 0;
+
+    render();
+    schedule_virtual_frame();
+}
+
+// arm the virtual clock for its next vblank, as soon as possible if it has
+// fallen behind the monotonic clock
+void Output::schedule_virtual_frame() const {
+    const int64_t delay_ns =
+        virtual_vblank_ns + virtual_refresh_ns() - get_time_nsec();
+    const int64_t delay_ms = (delay_ns + 999999) / 1000000;
+
+    // a timeout of 0 disarms the timer
+    wl_event_source_timer_update(
+        virtual_timer, static_cast<int>(std::max<int64_t>(delay_ms, 1)));
+}
+
+// refresh period of the virtual clock, 60Hz for outputs without a refresh
+int64_t Output::virtual_refresh_ns() const {
+    return wlr_output->refresh > 0 ? 1000000000000ll / wlr_output->refresh
+                                   : 1000000000ll / 60;
+}
+
+// get the 90th percentile of recent scene commit durations
+int64_t Output::predicted_render_time() const {
+    if (!commit_times_count)
+        return 0;
+
+    auto sorted = commit_times;
+    const auto end = sorted.begin() + commit_times_count;
+    const auto p90 = sorted.begin() + commit_times_count * 9 / 10;
+    std::nth_element(sorted.begin(), p90, end);
+
+    return *p90;
+}
+
+// predict when a frame rendered now would be presented
+int64_t Output::predicted_present_ns() const {
+    const int64_t ready_ns = get_time_nsec() + predicted_render_time();
+    if (wlr_output->refresh <= 0 || !last_present_ns)
+        return ready_ns;
+
+    // first vblank after the render is ready
+    const int64_t refresh_ns = 1000000000000ll / wlr_output->refresh;
+    const int64_t vblanks = std::max<int64_t>(
+        (ready_ns - last_present_ns + refresh_ns - 1) / refresh_ns, 1);
+
+    return last_present_ns + vblanks * refresh_ns;
+}
+
+// send frame done to the surfaces shown on this output, throttled to the
+// frame rate cap of each surface
+void Output::send_frame_done(const timespec *when) {
+    struct FrameDone {
+        Output *output;
+        const timespec *when;
+        int64_t now_ns;
+        int64_t next_ns;
+        std::unordered_map<wlr_surface *, int64_t> times;
+    } frame_done{
+        .output = this,
+        .when = when,
+        .now_ns = get_time_nsec(),
+        .next_ns = 0,
+        .times = {},
+    };
+
+    wlr_scene_output_for_each_buffer(
+        scene_output,
+        [](wlr_scene_buffer *buffer, [[maybe_unused]] int sx,
+           [[maybe_unused]] int sy, void *data) {
+            auto *frame_done = static_cast<FrameDone *>(data);
+            Output *output = frame_done->output;
+
+            // surfaces only get frame done from their primary output
+            if (buffer->primary_output != output->scene_output)
+                return;
+
+            const wlr_scene_surface *scene_surface =
+                wlr_scene_surface_try_from_buffer(buffer);
+            if (!scene_surface)
+                return;
+
+            wlr_surface *surface = scene_surface->surface;
+
+            // throttle capped surfaces, keeping the last time and waking up
+            // when due
+            int64_t due;
+            if (!output->frame_done_due(buffer, surface, frame_done->now_ns,
+                                        &due)) {
+                frame_done->times[surface] =
+                    output->frame_done_times.at(surface);
+                if (!frame_done->next_ns || due < frame_done->next_ns)
+                    frame_done->next_ns = due;
+                return;
+            }
+
+            // give toplevels with a render time the latest possible frame
+            // done, which records its own time when sent
+            Toplevel *toplevel =
+                output->server->toplevel_for_node(&buffer->node);
+            if (toplevel && toplevel->max_render_time) {
+                if (const int64_t delay_ms = output->frame_done_delay(
+                        toplevel, frame_done->now_ns)) {
+                    const auto last = output->frame_done_times.find(surface);
+                    if (last != output->frame_done_times.end())
+                        frame_done->times[surface] = last->second;
+
+                    toplevel->schedule_frame_done(delay_ms);
+                    return;
+                }
+
+                toplevel->frame_done_ns = frame_done->now_ns;
+            }
+
+            frame_done->times[surface] = frame_done->now_ns;
+            wlr_surface_send_frame_done(surface, frame_done->when);
+        },
+        &frame_done);
+
+    // only keep surfaces seen this frame
+    frame_done_times = std::move(frame_done.times);
+
+    // throttled surfaces need a frame even if nothing is damaged
+    if (frame_done.next_ns) {
+        const int64_t delay_ms =
+            (frame_done.next_ns - frame_done.now_ns + 999999) / 1000000;
+        wl_event_source_timer_update(frame_done_timer,
+                                     static_cast<int>(std::max<int64_t>(
+                                         delay_ms, 1)));
+    }
+}
+
+// returns true if a surface shown by the buffer is due a frame done under the
+// frame rate cap of its node, otherwise sets due_ns to when it is
+bool Output::frame_done_due(const wlr_scene_buffer *buffer,
+                            wlr_surface *surface, const int64_t now_ns,
+                            int64_t *due_ns) const {
+    const int64_t cap = frame_rate_cap(&buffer->node);
+    if (cap <= 0)
+        return true;
+
+    const auto last = frame_done_times.find(surface);
+    if (last == frame_done_times.end())
+        return true;
+
+    // allow half a refresh early so caps are not rounded down a frame
+    const int64_t slack_ns =
+        wlr_output->refresh > 0 ? 500000000000ll / wlr_output->refresh : 0;
+
+    *due_ns = last->second + 1000000000ll / cap - slack_ns;
+    return now_ns >= *due_ns;
+}
+
+// send frame done to a surface outside of a frame if it is due, as for a
+// delayed frame done
+void Output::send_surface_frame_done(const wlr_scene_buffer *buffer,
+                                     wlr_surface *surface,
+                                     const timespec *when,
+                                     const int64_t now_ns) {
+    // a throttled surface was already scheduled a frame by the last render
+    int64_t due;
+    if (!frame_done_due(buffer, surface, now_ns, &due))
+        return;
+
+    frame_done_times[surface] = now_ns;
+    wlr_surface_send_frame_done(surface, when);
+}
+
+// get the ms to delay frame done to a toplevel so it commits just before the
+// next render, 0 to send it now
+int64_t Output::frame_done_delay(const Toplevel *toplevel,
+                                 const int64_t now_ns) const {
+    if (wlr_output->refresh <= 0 || !last_frame_ns)
+        return 0;
+
+    // time the toplevel needs to render
+    int64_t budget_ns;
+    if (toplevel->max_render_time > 0)
+        budget_ns = toplevel->max_render_time * 1000000;
+    else if (toplevel->commit_latency_ns)
+        // measured, with a ms of headroom
+        budget_ns = toplevel->commit_latency_ns + 1000000;
+    else
+        return 0;
+
+    // the next render follows the next frame event by the same delay
+    const int64_t refresh_ns = 1000000000000ll / wlr_output->refresh;
+    const int64_t next_render_ns = last_frame_ns + refresh_ns + render_delay_ns;
+
+    return std::max<int64_t>((next_render_ns - budget_ns - now_ns) / 1000000,
+                             0);
+}
+
+// get the frame rate cap of a node on this output, 0 for uncapped
+int64_t Output::frame_rate_cap(const wlr_scene_node *node) const {
+    const Config *config = server->config;
+
+    // find the layer the node belongs to
+    for (; node && node->parent; node = &node->parent->node) {
+        const wlr_scene_tree *parent = node->parent;
+
+        // layer shell background
+        if (parent == layers.background)
+            return frame_rate.background ? frame_rate.background
+                                         : config->frame_rate.background;
+
+        // toplevels
+        if (parent == server->layers.floating ||
+            parent == server->layers.fullscreen) {
+            const Toplevel *toplevel = static_cast<Toplevel *>(node->data);
+            if (!toplevel)
+                return 0;
+
+            // window rule cap
+            int64_t cap = toplevel->max_fps;
+
+            // the focused toplevel is only capped by its rule
+            if (toplevel->get_surface() ==
+                server->seat->keyboard_state.focused_surface)
+                return cap;
+
+            const int64_t unfocused = frame_rate.unfocused
+                                          ? frame_rate.unfocused
+                                          : config->frame_rate.unfocused;
+            if (unfocused > 0 && (cap <= 0 || unfocused < cap))
+                cap = unfocused;
+
+            return cap;
+        }
+    }
+
+    return 0;
+}
+
+// find the opaque fullscreen toplevel covering this output, if any, and
+// disable the layer shell layers beneath it
+Toplevel *Output::update_fullscreen() {
+    const Workspace *workspace = get_active();
+    Toplevel *toplevel = workspace ? workspace->fullscreen_toplevel() : nullptr;
+
+    // translucent or partial fullscreen toplevels show what is beneath
+    if (toplevel &&
+        (!toplevel->opaque() || !box_contains(toplevel->geometry,
+                                              layout_geometry)))
+        toplevel = nullptr;
+
+    const bool enabled = !toplevel;
+    wlr_scene_node_set_enabled(&layers.background->node, enabled);
+    wlr_scene_node_set_enabled(&layers.bottom->node, enabled);
+    wlr_scene_node_set_enabled(&layers.top->node, enabled);
+
+    return toplevel;
+}
+
+// switch adaptive sync and refresh rate depending on whether a game or video
+// is fullscreen on this output
+void Output::update_content_policy() {
+    if (!wlr_output->enabled)
+        return;
+
+    // content type of the fullscreen toplevel
+    const Workspace *workspace = get_active();
+    const Toplevel *toplevel =
+        workspace ? workspace->fullscreen_toplevel() : nullptr;
+    wlr_surface *surface = toplevel ? toplevel->get_surface() : nullptr;
+    const wp_content_type_v1_type type =
+        surface ? wlr_surface_get_content_type_v1(
+                      server->wlr_content_type_manager, surface)
+                : WP_CONTENT_TYPE_V1_TYPE_NONE;
+
+    const bool dynamic = type == WP_CONTENT_TYPE_V1_TYPE_GAME ||
+                         type == WP_CONTENT_TYPE_V1_TYPE_VIDEO;
+    if (content_policy_applied && dynamic == content_dynamic)
+        return;
+
+    content_dynamic = dynamic;
+    content_policy_applied = true;
+
+    wlr_output_state state{};
+    wlr_output_state_init(&state);
+
+    // adaptive sync while a game or video is fullscreen
+    if (config.adaptive_sync_auto && wlr_output->adaptive_sync_supported &&
+        (wlr_output->adaptive_sync_status ==
+         WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED) != dynamic)
+        wlr_output_state_set_adaptive_sync_enabled(&state, dynamic);
+
+    // lower refresh rate for desktop content
+    if (config.desktop_refresh > 0)
+        if (wlr_output_mode *mode = find_mode(
+                config.width, config.height,
+                dynamic ? config.refresh : config.desktop_refresh);
+            mode && mode != wlr_output->current_mode)
+            wlr_output_state_set_mode(&state, mode);
+
+    // nothing to change
+    if (!state.committed) {
+        wlr_output_state_finish(&state);
+        return;
+    }
+
+    if (wlr_output_test_state(wlr_output, &state)) {
+        wlr_log(WLR_INFO, "output %s switched to %s content policy",
+                wlr_output->name, dynamic ? "fullscreen" : "desktop");
+        wlr_output_commit_state(wlr_output, &state);
+    } else
+        wlr_log(WLR_INFO, "output %s rejected %s content policy",
+                wlr_output->name, dynamic ? "fullscreen" : "desktop");
+
+    wlr_output_state_finish(&state);
+}
+
+// restore the full refresh rate and keep the output from idling
+void Output::notify_activity() {
+    const int64_t timeout = server->config->render.idle_timeout;
+    if (config.idle_refresh <= 0 || timeout <= 0)
+        return;
+
+    const int64_t now = get_time_nsec();
+    last_activity_ns = now;
+
+    if (idle_downshifted) {
+        // woken right after idling, wait longer before the next downshift
+        if (now - idle_since_ns < timeout * 1000000000ll)
+            idle_backoff = std::min<int64_t>(idle_backoff * 2, 8);
+        else
+            idle_backoff = 1;
+
+        set_idle_refresh(false);
+    }
+
+    // the timer checks the last activity when it fires
+    if (!idle_timer_armed) {
+        idle_timer_armed = true;
+        wl_event_source_timer_update(
+            idle_timer, static_cast<int>(timeout * idle_backoff * 1000));
+    }
+}
+
+// downshift the refresh rate if there was no activity for the idle timeout
+void Output::check_idle() {
+    idle_timer_armed = false;
+
+    const int64_t timeout_ns =
+        server->config->render.idle_timeout * idle_backoff * 1000000000ll;
+    if (config.idle_refresh <= 0 || timeout_ns <= 0 || idle_downshifted)
+        return;
+
+    // activity since the timer was armed
+    const int64_t remaining_ns =
+        last_activity_ns + timeout_ns - get_time_nsec();
+    if (remaining_ns > 0) {
+        idle_timer_armed = true;
+        wl_event_source_timer_update(
+            idle_timer, static_cast<int>(remaining_ns / 1000000 + 1));
+        return;
+    }
+
+    // games and videos are never idle
+    if (!content_dynamic)
+        set_idle_refresh(true);
+}
+
+// switch between the idle refresh rate and the one it replaced
+bool Output::set_idle_refresh(const bool idle) {
+    if (idle == idle_downshifted || !wlr_output->enabled)
+        return false;
+
+    wlr_output_state state{};
+    wlr_output_state_init(&state);
+
+    if (idle) {
+        const int32_t refresh =
+            static_cast<int32_t>(config.idle_refresh * 1000);
+
+        // outputs without modes, such as headless ones, take custom modes
+        if (wl_list_empty(&wlr_output->modes))
+            wlr_output_state_set_custom_mode(&state, wlr_output->width,
+                                             wlr_output->height, refresh);
+        else if (wlr_output_mode *mode =
+                     find_mode(wlr_output->width, wlr_output->height,
+                               config.idle_refresh);
+                 mode && mode->refresh < wlr_output->refresh)
+            wlr_output_state_set_mode(&state, mode);
+    } else if (idle_saved_mode)
+        wlr_output_state_set_mode(&state, idle_saved_mode);
+    else
+        wlr_output_state_set_custom_mode(&state, wlr_output->width,
+                                         wlr_output->height,
+                                         idle_saved_refresh);
+
+    // no lower mode, or it is not supported
+    if (!state.committed ||
+        (idle && !wlr_output_test_state(wlr_output, &state))) {
+        wlr_output_state_finish(&state);
+        return false;
+    }
+
+    // remember what to restore
+    wlr_output_mode *previous_mode = wlr_output->current_mode;
+    const int32_t previous_refresh = wlr_output->refresh;
+
+    const bool success = wlr_output_commit_state(wlr_output, &state);
+    wlr_output_state_finish(&state);
+
+    if (!success) {
+        wlr_log(WLR_ERROR, "output %s failed to %s refresh rate",
+                wlr_output->name, idle ? "lower" : "restore");
+        return false;
+    }
+
+    if (idle) {
+        idle_saved_mode = previous_mode;
+        idle_saved_refresh = previous_refresh;
+        idle_since_ns = get_time_nsec();
+    }
+
+    idle_downshifted = idle;
+
+    // the switch redraws the output, that is not activity
+    idle_grace_ns = get_time_nsec() + 250000000;
+
+    wlr_log(WLR_INFO, "output %s %s refresh rate to %.3f Hz", wlr_output->name,
+            idle ? "lowered" : "restored", wlr_output->refresh / 1000.0);
+    return true;
+}
+
+// power the output on or off, keeping it in the layout with its workspaces
+bool Output::set_power(const bool on) {
+    if (on == wlr_output->enabled)
+        return true;
+
+    wlr_output_state state{};
+    wlr_output_state_init(&state);
+    wlr_output_state_set_enabled(&state, on);
+
+    // restore the mode it had before powering off
+    if (on && power_saved_mode)
+        wlr_output_state_set_mode(&state, power_saved_mode);
+    else if (on && power_saved_refresh)
+        wlr_output_state_set_custom_mode(&state, power_saved_width,
+                                         power_saved_height,
+                                         power_saved_refresh);
+
+    wlr_output_mode *previous_mode = wlr_output->current_mode;
+    const int32_t previous_width = wlr_output->width;
+    const int32_t previous_height = wlr_output->height;
+    const int32_t previous_refresh = wlr_output->refresh;
+
+    const bool success = wlr_output_commit_state(wlr_output, &state);
+    wlr_output_state_finish(&state);
+
+    if (!success) {
+        wlr_log(WLR_ERROR, "failed to power %s output %s", on ? "on" : "off",
+                wlr_output->name);
+        return false;
+    }
+
+    if (!on) {
+        power_saved_mode = previous_mode;
+        power_saved_width = previous_width;
+        power_saved_height = previous_height;
+        power_saved_refresh = previous_refresh;
+    } else {
+        // the content policy was not applied while off
+        content_policy_applied = false;
+        wlr_output_schedule_frame(wlr_output);
+    }
+
+    // inhibitors on this output may no longer be visible
+    server->schedule_visibility();
+    return true;
+}
+
 // arrange all layers
 void Output::arrange_layers() {
     wlr_box usable = {};
@@ -207,66 +939,105 @@ bool Output::set_workspace(const uint32_t n) {
     return true;
 }
 
+// find the mode of the given size with the refresh rate closest to refresh
+wlr_output_mode *Output::find_mode(const int32_t width, const int32_t height,
+                                   const double refresh) const {
+    wlr_output_mode *mode, *best_mode = nullptr;
+    wl_list_for_each(
+        mode, &wlr_output->modes,
+        link) if ((mode->width == width && mode->height == height) &&
+                  (!best_mode ||
+                   (abs(static_cast<int>(mode->refresh / 1000.0 - refresh)) <
+                        1.5 &&
+                    abs(static_cast<int>(mode->refresh / 1000.0 - refresh)) <
+                        abs(static_cast<int>(best_mode->refresh / 1000.0 -
+                                             refresh))))) best_mode = mode;
+
+    return best_mode;
+}
+
 // update layout geometry
 void Output::update_position() {
     wlr_output_layout_get_box(server->output_manager->layout, wlr_output,
                               &layout_geometry);
 }
 
-// apply a config to the output
-bool Output::apply_config(const OutputConfig *config, const bool test_only) {
-    // create output state
-    wlr_output_state state{};
-    wlr_output_state_init(&state);
-
+// fill an output state from a config
+void Output::build_state(const OutputConfig *config,
+                         wlr_output_state *state) const {
     // enabled
-    wlr_output_state_set_enabled(&state, config->enabled);
+    wlr_output_state_set_enabled(state, config->enabled);
 
-    if (config->enabled) {
-        // set mode
-        bool mode_set = false;
-        if (config->width > 0 && config->height > 0 && config->refresh > 0) {
+    if (!config->enabled)
+        return;
+
+    // set mode
+    bool mode_set = false;
+    if (config->width > 0 && config->height > 0 && config->refresh > 0) {
+        if (wl_list_empty(&wlr_output->modes)) {
+            // outputs without modes, such as headless ones, take custom modes
+            wlr_output_state_set_custom_mode(
+                state, config->width, config->height,
+                static_cast<int32_t>(config->refresh * 1000));
+            mode_set = true;
+        } else if (wlr_output_mode *best_mode = find_mode(
+                       config->width, config->height, config->refresh)) {
             // find matching mode
-            wlr_output_mode *mode, *best_mode = nullptr;
-            wl_list_for_each(
-                mode, &wlr_output->modes,
-                link) if ((mode->width == config->width &&
-                           mode->height == config->height) &&
-                          (!best_mode ||
-                           (abs(static_cast<int>(mode->refresh / 1000.0 -
-                                                 config->refresh)) < 1.5 &&
-                            abs(static_cast<int>(mode->refresh / 1000.0 -
-                                                 config->refresh)) <
-                                abs(static_cast<int>(
-                                    best_mode->refresh / 1000.0 -
-                                    config->refresh))))) best_mode = mode;
-
-            if (best_mode) {
-                wlr_output_state_set_mode(&state, best_mode);
-                mode_set = true;
-            }
+            wlr_output_state_set_mode(state, best_mode);
+            mode_set = true;
         }
+    }
 
-        // set to preferred mode if not set
-        if (!mode_set) {
-            wlr_output_state_set_mode(&state,
-                                      wlr_output_preferred_mode(wlr_output));
-            wlr_log(WLR_INFO, "using fallback mode for output %s",
-                    config->name.c_str());
-        }
+    // set to preferred mode if not set
+    if (!mode_set) {
+        if (wlr_output_mode *preferred = wlr_output_preferred_mode(wlr_output))
+            wlr_output_state_set_mode(state, preferred);
+        wlr_log(WLR_INFO, "using fallback mode for output %s",
+                config->name.c_str());
+    }
 
-        // scale
-        if (config->scale > 0)
-            wlr_output_state_set_scale(&state,
-                                       static_cast<float>(config->scale));
+    // scale
+    if (config->scale > 0)
+        wlr_output_state_set_scale(state, static_cast<float>(config->scale));
 
-        // transform
-        wlr_output_state_set_transform(&state, config->transform);
+    // transform
+    wlr_output_state_set_transform(state, config->transform);
 
-        // adaptive sync
-        wlr_output_state_set_adaptive_sync_enabled(&state,
-                                                   config->adaptive_sync);
-    }
+    // adaptive sync, the content policy enables it when automatic
+    wlr_output_state_set_adaptive_sync_enabled(
+        state, config->adaptive_sync && !config->adaptive_sync_auto);
+}
+
+// a config was committed to the output, take on its settings and position
+void Output::config_applied(const OutputConfig *config) {
+    // frame rate caps
+    frame_rate.unfocused = config->unfocused_fps;
+    frame_rate.background = config->background_fps;
+
+    // tearing
+    allow_tearing = config->allow_tearing;
+
+    // reapply the content policy for the new config
+    this->config = *config;
+    content_policy_applied = false;
+    server->schedule_visibility();
+
+    // the new mode is the full refresh rate
+    idle_downshifted = false;
+    notify_activity();
+
+    // update position
+    wlr_output_layout_add(server->output_manager->layout, wlr_output,
+                          static_cast<int>(config->x),
+                          static_cast<int>(config->y));
+}
+
+// apply a config to the output
+bool Output::apply_config(const OutputConfig *config, const bool test_only) {
+    // create output state
+    wlr_output_state state{};
+    wlr_output_state_init(&state);
+    build_state(config, &state);
 
     bool success;
     if (test_only)
@@ -277,10 +1048,7 @@ bool Output::apply_config(const OutputConfig *config, const bool test_only) {
         success = wlr_output_commit_state(wlr_output, &state);
 
         if (success) {
-            // update position
-            wlr_output_layout_add(server->output_manager->layout, wlr_output,
-                                  static_cast<int>(config->x),
-                                  static_cast<int>(config->y));
+            config_applied(config);
 
             // rearrange
             arrange_layers();
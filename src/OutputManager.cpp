@@ -1,5 +1,6 @@
 #include "Server.h"
 #include <map>
+#include <vector>
 
 OutputManager::OutputManager(Server *server) : server(server) {
     layout = wlr_output_layout_create(server->display);
@@ -69,10 +70,11 @@ OutputManager::OutputManager(Server *server) : server(server) {
             wlr_output_state state{};
             wlr_output_state_init(&state);
 
-            // use preferred mode
+            // use preferred mode, outputs without modes keep their own
             wlr_output_state_set_enabled(&state, true);
-            wlr_output_state_set_mode(&state,
-                                      wlr_output_preferred_mode(wlr_output));
+            if (wlr_output_mode *preferred =
+                    wlr_output_preferred_mode(wlr_output))
+                wlr_output_state_set_mode(&state, preferred);
 
             // commit state
             config_success = wlr_output_commit_state(wlr_output, &state);
@@ -89,6 +91,7 @@ OutputManager::OutputManager(Server *server) : server(server) {
         // add to scene output
         wlr_scene_output *scene_output =
             wlr_scene_output_create(server->scene, wlr_output);
+        output->scene_output = scene_output;
         wlr_scene_output_layout_add_output(server->scene_layout,
                                            output_layout_output, scene_output);
 
@@ -137,37 +140,83 @@ OutputManager::~OutputManager() {
     wl_list_remove(&change.link);
 }
 
+// apply an output management configuration to all outputs at once, with a
+// single backend test and commit
 void OutputManager::apply_config(wlr_output_configuration_v1 *cfg,
                                  bool test_only) const {
     // create a map of output names to configs
-    std::map<std::string, OutputConfig *> config_map;
+    std::map<std::string, OutputConfig> config_map;
 
     // add existing configs
-    for (OutputConfig *c : server->config->outputs)
-        config_map[c->name] = c;
+    for (const OutputConfig *c : server->config->outputs)
+        config_map[c->name] = *c;
 
     // override with new configs from cfg
     wlr_output_configuration_head_v1 *config_head;
     wl_list_for_each(config_head, &cfg->heads, link) {
-        std::string name = config_head->state.output->name;
-        config_map[name] = new OutputConfig(config_head);
+        OutputConfig oc(config_head);
+
+        // keep settings the protocol does not cover
+        if (const auto it = config_map.find(oc.name); it != config_map.end()) {
+            oc.unfocused_fps = it->second.unfocused_fps;
+            oc.background_fps = it->second.background_fps;
+            oc.allow_tearing = it->second.allow_tearing;
+            oc.desktop_refresh = it->second.desktop_refresh;
+            oc.idle_refresh = it->second.idle_refresh;
+
+            // the head reports the state content policy set, not the config
+            oc.adaptive_sync_auto = it->second.adaptive_sync_auto;
+            if (oc.adaptive_sync_auto)
+                oc.adaptive_sync = it->second.adaptive_sync;
+        }
+
+        config_map[oc.name] = oc;
     }
 
-    // apply each config
-    bool success = true;
-    Output *output, *tmp;
-    wl_list_for_each_safe(output, tmp, &outputs, link) {
-        OutputConfig *oc = config_map[output->wlr_output->name];
-        success &= output->apply_config(oc, test_only);
+    // build the state of every configured output
+    std::vector<std::pair<Output *, const OutputConfig *>> applied;
+    std::vector<wlr_backend_output_state> states;
+    Output *output;
+    wl_list_for_each(output, &outputs, link) {
+        const auto it = config_map.find(output->wlr_output->name);
+        if (it == config_map.end())
+            continue;
+
+        wlr_backend_output_state &state = states.emplace_back();
+        state.output = output->wlr_output;
+        wlr_output_state_init(&state.base);
+        output->build_state(&it->second, &state.base);
+
+        applied.emplace_back(output, &it->second);
     }
 
+    // test all outputs together, then commit them in one modeset
+    bool success =
+        wlr_backend_test(server->backend, states.data(), states.size());
+    if (success && !test_only)
+        success =
+            wlr_backend_commit(server->backend, states.data(), states.size());
+
+    for (wlr_backend_output_state &state : states)
+        wlr_output_state_finish(&state.base);
+
     // send cfg status
     if (success)
         wlr_output_configuration_v1_send_succeeded(cfg);
     else
         wlr_output_configuration_v1_send_failed(cfg);
+    wlr_output_configuration_v1_destroy(cfg);
+
+    if (!success || test_only)
+        return;
+
+    // update positions, then arrange once
+    for (const auto &[applied_output, config] : applied)
+        applied_output->config_applied(config);
 
     arrange();
+    for (const auto &[applied_output, config] : applied)
+        applied_output->arrange_layers();
 }
 
 // get output by wlr_output
@@ -197,6 +246,8 @@ Output *OutputManager::output_at(const double x, const double y) {
 
 // arrange layer shell layers on each output
 void OutputManager::arrange() const {
+    TraceSpan span("arrange");
+
     Output *output, *tmp;
     wl_list_for_each_safe(output, tmp, &outputs, link) {
         // tell outputs to update their positions
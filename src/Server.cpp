@@ -16,6 +16,150 @@ Workspace *Server::get_workspace(Toplevel *toplevel) const {
     return nullptr;
 }
 
+// focus a toplevel on any output, warping the cursor to it if it is not on
+// the focused output
+void Server::focus_toplevel(Toplevel *toplevel) const {
+    Workspace *workspace = get_workspace(toplevel);
+    if (!workspace)
+        return;
+
+    // keep the cursor on the output that has focus
+    if (workspace->output != focused_output()) {
+        const wlr_box &box = toplevel->geometry;
+        wlr_cursor_warp(cursor->cursor, nullptr, box.x + box.width / 2.0,
+                        box.y + box.height / 2.0);
+    }
+
+    workspace->focus_toplevel(toplevel);
+}
+
+// user input, resets idle timers and returns outputs to their full refresh
+// rate
+void Server::notify_activity() const {
+    wlr_idle_notifier_v1_notify_activity(wlr_idle_notifier, seat);
+
+    Output *output;
+    wl_list_for_each(output, &output_manager->outputs, link)
+        output->notify_activity();
+}
+
+// returns true if input from the device is recorded, replayed input is not
+bool Server::records(const wlr_input_device *device) const {
+    return input_recorder &&
+           !(input_replay && (device == &input_replay->keyboard.base ||
+                              device == &input_replay->pointer.base));
+}
+
+// recompute toplevel visibility once the current dispatch is done
+void Server::schedule_visibility() {
+    // already scheduled
+    if (visibility_idle)
+        return;
+
+    visibility_idle = wl_event_loop_add_idle(
+        wl_display_get_event_loop(display),
+        [](void *data) {
+            Server *server = static_cast<Server *>(data);
+            server->visibility_idle = nullptr;
+            server->update_visibility();
+        },
+        this);
+}
+
+// suspend every toplevel that cannot be seen: hidden, minimized, behind the
+// lock screen or fully covered by opaque or fullscreen toplevels above it.
+// toplevels beneath an opaque fullscreen toplevel covering its output are
+// disabled in the scene as well
+void Server::update_visibility() {
+    // opaque fullscreen toplevels covering their output
+    std::vector<Toplevel *> fullscreen;
+    Output *output;
+    wl_list_for_each(output, &output_manager->outputs, link) {
+        if (Toplevel *toplevel = output->update_fullscreen())
+            fullscreen.emplace_back(toplevel);
+
+        // fullscreen content decides adaptive sync and refresh rate
+        output->update_content_policy();
+    }
+
+    // outputs covered by a fullscreen toplevel above the current one
+    std::vector<wlr_box> fullscreen_boxes;
+
+    // area covered by opaque toplevels, in layout coordinates
+    pixman_region32_t covered;
+    pixman_region32_init(&covered);
+
+    // walk toplevels from top to bottom
+    wlr_scene_tree *trees[] = {layers.fullscreen, layers.floating};
+    for (const wlr_scene_tree *tree : trees) {
+        wlr_scene_node *node;
+        wl_list_for_each_reverse(node, &tree->children, link) {
+            Toplevel *toplevel = static_cast<Toplevel *>(node->data);
+
+            // only mapped toplevels can be configured
+            const wlr_surface *surface =
+                toplevel ? toplevel->get_surface() : nullptr;
+            if (!surface || !surface->mapped)
+                continue;
+
+            // not visible at all
+            if (locked || toplevel->hidden || toplevel->minimized) {
+                toplevel->set_covered(false);
+                toplevel->set_suspended(true);
+                continue;
+            }
+
+            // disable toplevels beneath a fullscreen toplevel
+            const bool beneath_fullscreen = std::any_of(
+                fullscreen_boxes.begin(), fullscreen_boxes.end(),
+                [toplevel](const wlr_box &box) {
+                    return box_contains(box, toplevel->geometry);
+                });
+            toplevel->set_covered(beneath_fullscreen);
+
+            if (std::find(fullscreen.begin(), fullscreen.end(), toplevel) !=
+                fullscreen.end())
+                fullscreen_boxes.emplace_back(toplevel->geometry);
+
+            if (beneath_fullscreen) {
+                toplevel->set_suspended(true);
+                continue;
+            }
+
+            // check if the toplevel is fully covered
+            const wlr_box &box = toplevel->geometry;
+            pixman_box32_t rect{
+                .x1 = box.x,
+                .y1 = box.y,
+                .x2 = box.x + box.width,
+                .y2 = box.y + box.height,
+            };
+            toplevel->set_suspended(
+                !wlr_box_empty(&box) &&
+                pixman_region32_contains_rectangle(&covered, &rect) ==
+                    PIXMAN_REGION_IN);
+
+            // add to covered area
+            if (toplevel->fullscreen() || toplevel->opaque())
+                pixman_region32_union_rect(&covered, &covered, box.x, box.y,
+                                           box.width, box.height);
+        }
+    }
+
+    pixman_region32_fini(&covered);
+
+    // only inhibitors of visible surfaces keep the session from idling
+    bool inhibited = false;
+    IdleInhibitor *inhibitor;
+    wl_list_for_each(inhibitor, &idle_inhibitors, link) {
+        if (inhibitor->visible()) {
+            inhibited = true;
+            break;
+        }
+    }
+    wlr_idle_notifier_v1_set_inhibited(wlr_idle_notifier, inhibited);
+}
+
 // get a node tree surface from its location and cast it to the generic
 // type provided
 template <typename T>
@@ -109,6 +253,17 @@ Toplevel *Server::get_toplevel(wlr_surface *surface) const {
     return nullptr;
 }
 
+// get the toplevel a scene node belongs to
+Toplevel *Server::toplevel_for_node(const wlr_scene_node *node) const {
+    // walk up to the toplevel layers
+    for (; node && node->parent; node = &node->parent->node)
+        if (node->parent == layers.floating ||
+            node->parent == layers.fullscreen)
+            return static_cast<Toplevel *>(node->data);
+
+    return nullptr;
+}
+
 // get the focused output
 Output *Server::focused_output() const {
     return output_manager->output_at(cursor->cursor->x, cursor->cursor->y);
@@ -121,9 +276,22 @@ Server::Server(Config *config) : config(config) {
     // display
     display = wl_display_create();
 
+    // spatial index of visible toplevels
+    toplevel_index = new ToplevelIndex();
+
     // backend
-    backend =
-        wlr_backend_autocreate(wl_display_get_event_loop(display), &session);
+    if (config->bench.enabled) {
+        // headless outputs only, no session or input devices
+        session = nullptr;
+        backend =
+            wlr_headless_backend_create(wl_display_get_event_loop(display));
+        if (backend)
+            for (int i = 0; i != config->bench.outputs; ++i)
+                wlr_headless_add_output(backend, config->bench.width,
+                                        config->bench.height);
+    } else
+        backend = wlr_backend_autocreate(wl_display_get_event_loop(display),
+                                         &session);
     if (!backend) {
         wlr_log(WLR_ERROR, "failed to create wlr_backend");
         ::exit(1);
@@ -163,6 +331,9 @@ Server::Server(Config *config) : config(config) {
     wlr_subcompositor_create(display);
     wlr_data_device_manager_create(display);
 
+    // per client resource usage
+    client_tracker = new ClientTracker(this);
+
     // output manager
     output_manager = new OutputManager(this);
 
@@ -460,18 +631,68 @@ Server::Server(Config *config) : config(config) {
     wlr_single_pixel_buffer_manager =
         wlr_single_pixel_buffer_manager_v1_create(display);
 
-    // avoid using "wayland-0" as display socket
+    // tearing control
+    wlr_tearing_control_manager =
+        wlr_tearing_control_manager_v1_create(display, 1);
+
+    // content type
+    wlr_content_type_manager =
+        wlr_content_type_manager_v1_create(display, 1);
+
+    // fifo and commit timing
+    fifo_manager = new FifoManager(this);
+    commit_timing_manager = new CommitTimingManager(this);
+
+    // idle notifier
+    wlr_idle_notifier = wlr_idle_notifier_v1_create(display);
+
+    // idle inhibit
+    wl_list_init(&idle_inhibitors);
+    wlr_idle_inhibit_manager = wlr_idle_inhibit_v1_create(display);
+
+    new_idle_inhibitor.notify = [](wl_listener *listener, void *data) {
+        Server *server = wl_container_of(listener, server, new_idle_inhibitor);
+
+        [[maybe_unused]] IdleInhibitor *inhibitor = new IdleInhibitor(
+            server, static_cast<wlr_idle_inhibitor_v1 *>(data));
+    };
+    wl_signal_add(&wlr_idle_inhibit_manager->events.new_inhibitor,
+                  &new_idle_inhibitor);
+
+    // output power management
+    wlr_output_power_manager = wlr_output_power_manager_v1_create(display);
+
+    set_output_power_mode.notify = [](wl_listener *listener, void *data) {
+        Server *server =
+            wl_container_of(listener, server, set_output_power_mode);
+
+        const auto *event =
+            static_cast<wlr_output_power_v1_set_mode_event *>(data);
+        if (Output *output = server->get_output(event->output))
+            output->set_power(event->mode == ZWLR_OUTPUT_POWER_V1_MODE_ON);
+    };
+    wl_signal_add(&wlr_output_power_manager->events.set_mode,
+                  &set_output_power_mode);
+
+    // avoid using "wayland-0" as display socket, benchmark instances use
+    // their own
     std::string socket;
-    for (unsigned int i = 1; i <= 32; i++) {
-        socket = "wayland-" + std::to_string(i);
-        if (const int ret = wl_display_add_socket(display, socket.c_str());
-            !ret)
-            break;
-        else
-            wlr_log(WLR_ERROR,
-                    "wl_display_add_socket for %s returned %d: skipping",
-                    socket.c_str(), ret);
-    }
+    if (config->bench.enabled) {
+        socket = "awm-bench-" + std::to_string(getpid());
+        if (wl_display_add_socket(display, socket.c_str()))
+            socket.clear();
+    } else
+        for (unsigned int i = 1; i <= 32; i++) {
+            socket = "wayland-" + std::to_string(i);
+            if (const int ret =
+                    wl_display_add_socket(display, socket.c_str());
+                !ret)
+                break;
+            else
+                wlr_log(WLR_ERROR,
+                        "wl_display_add_socket for %s returned %d: skipping",
+                        socket.c_str(), ret);
+        }
 
     if (socket.empty()) {
         wlr_log(WLR_DEBUG, "Unable to open wayland socket");
@@ -529,6 +750,22 @@ Server::Server(Config *config) : config(config) {
         wlr_log(WLR_ERROR, "failed to start Xwayland");
 #endif
 
+    // record input from the real devices
+    if (!config->input.record.empty())
+        input_recorder = new InputRecorder(config->input.record);
+
+    // replay a recording through virtual devices
+    if (!config->input.replay.empty()) {
+        input_replay =
+            new InputReplay(this, config->input.replay, config->input.speed);
+        if (input_replay->load())
+            input_replay->start();
+        else {
+            delete input_replay;
+            input_replay = nullptr;
+        }
+    }
+
     // start IPC
     if (config->ipc)
         ipc = new IPC(this);
@@ -551,6 +788,10 @@ Server::Server(Config *config) : config(config) {
     // set wayland display to our socket
     setenv("WAYLAND_DISPLAY", socket.c_str(), true);
 
+    // let awmsg find this instance
+    if (config->ipc)
+        setenv("AWM_SOCK", config->ipc_socket.c_str(), true);
+
     // set xdg current desktop for portals
     setenv("XDG_CURRENT_DESKTOP", "awm", true);
 
@@ -559,9 +800,11 @@ Server::Server(Config *config) : config(config) {
         setenv(key.c_str(), value.c_str(), true);
 
     // run startup commands from config
-    for (const std::string &command : config->startup_commands)
+    for (const std::string &command : config->startup_commands) {
         if (fork() == 0)
             execl("/bin/sh", "/bin/sh", "-c", command.c_str(), nullptr);
+        ++metrics.spawned_processes;
+    }
 
     // run thread for config updater
     config_thread = std::thread([&]() {
@@ -577,24 +820,50 @@ Server::Server(Config *config) : config(config) {
     // run event loop
     wlr_log(WLR_INFO, "Running Wayland compositor on WAYLAND_DISPLAY=%s",
             socket.c_str());
-    wl_display_run(display);
+    if (config->watchdog.enabled) {
+        watchdog = new Watchdog(this);
+        watchdog->run();
+    } else
+        wl_display_run(display);
 }
 
 void Server::exit() const {
+    // stop the watchdog loop first, it may wake for the terminate before
+    // seeing it stop otherwise
+    if (watchdog)
+        watchdog->stop();
     wl_display_terminate(display);
 
     // run exit commands
-    for (const std::string &command : config->exit_commands)
+    for (const std::string &command : config->exit_commands) {
         if (fork() == 0)
             execl("/bin/sh", "/bin/sh", "-c", command.c_str(), nullptr);
+        ++metrics.spawned_processes;
+    }
 
-    // stop IPC
+    // stop IPC, it is destroyed with the server
     if (ipc)
         ipc->stop();
 }
 
 Server::~Server() {
     wl_display_destroy_clients(display);
+    delete client_tracker;
+
+    // joins the IPC thread, which may still be answering an exit request
+    delete ipc;
+    ipc = nullptr;
+
+    if (visibility_idle)
+        wl_event_source_remove(visibility_idle);
+
+    delete watchdog;
+    watchdog = nullptr;
+
+    delete input_replay;
+    input_replay = nullptr;
+    delete input_recorder;
+    input_recorder = nullptr;
 
     running = false;
     if (config_thread.joinable())
@@ -602,6 +871,9 @@ Server::~Server() {
 
     delete output_manager;
 
+    delete fifo_manager;
+    delete commit_timing_manager;
+
     wl_list_remove(&new_xdg_toplevel.link);
 
     wl_list_remove(&new_input.link);
@@ -614,6 +886,8 @@ Server::~Server() {
     wl_list_remove(&new_session_lock.link);
     wl_list_remove(&new_virtual_pointer.link);
     wl_list_remove(&new_pointer_constraint.link);
+    wl_list_remove(&new_idle_inhibitor.link);
+    wl_list_remove(&set_output_power_mode.link);
 
     LayerSurface *surface, *tmp;
     wl_list_for_each_safe(surface, tmp, &layer_surfaces, link) delete surface;
@@ -627,9 +901,12 @@ Server::~Server() {
     wlr_scene_node_destroy(&scene->tree.node);
 
     delete cursor;
+    cursor = nullptr;
 
     wlr_allocator_destroy(allocator);
     wlr_renderer_destroy(renderer);
     wlr_backend_destroy(backend);
     wl_display_destroy(display);
+
+    delete toplevel_index;
 }
@@ -75,6 +75,7 @@ SessionLock::SessionLock(Server *server, wlr_session_lock_v1 *session_lock)
 
         // unlock
         server->locked = false;
+        server->schedule_visibility();
 
         // clear keyboard focus
         wlr_seat_keyboard_notify_clear_focus(server->seat);
@@ -96,6 +97,9 @@ SessionLock::SessionLock(Server *server, wlr_session_lock_v1 *session_lock)
     // lock the session
     wlr_session_lock_v1_send_locked(session_lock);
     server->locked = true;
+
+    // everything behind the lock screen is suspended
+    server->schedule_visibility();
 }
 
 SessionLock::~SessionLock() {
@@ -0,0 +1,148 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+// add an item to the index or refresh its box
+void SpatialIndex::insert(void *item, const Box &box) {
+    remove(item);
+
+    const auto x = by_x.emplace(box.center_x(), item);
+    const auto y = by_y.emplace(box.center_y(), item);
+
+    entries[item] = Entry{box, x, y};
+}
+
+// refresh the box of an item if it is indexed, returns true if it moved
+bool SpatialIndex::update(void *item, const Box &box) {
+    const auto it = entries.find(item);
+    if (it == entries.end())
+        return false;
+
+    // box did not change
+    const Box &current = it->second.box;
+    if (current.x == box.x && current.y == box.y &&
+        current.width == box.width && current.height == box.height)
+        return false;
+
+    insert(item, box);
+    return true;
+}
+
+// remove an item from the index
+void SpatialIndex::remove(const void *item) {
+    const auto it = entries.find(item);
+    if (it == entries.end())
+        return;
+
+    by_x.erase(it->second.x);
+    by_y.erase(it->second.y);
+    entries.erase(it);
+}
+
+// returns true if the item is indexed
+bool SpatialIndex::contains(const void *item) const {
+    return entries.find(item) != entries.end();
+}
+
+// get the nearest item from the passed one in the specified direction,
+// returns nullptr if no item matches query. the walk visits every item whose
+// center along the direction lies within the best score found so far, so a
+// query costs O(log n + k) for k such items, about one row or column of a grid
+void *SpatialIndex::in_direction(const void *from,
+                                 const Direction direction) const {
+    const auto it = entries.find(from);
+    if (it == entries.end())
+        return nullptr;
+
+    const Box &box = it->second.box;
+    const bool horizontal =
+        direction == Direction::Left || direction == Direction::Right;
+    const int center = horizontal ? box.center_x() : box.center_y();
+
+    // span of the item on the perpendicular axis
+    const int start = horizontal ? box.y : box.x;
+    const int end = horizontal ? box.y + box.height : box.x + box.width;
+
+    void *target = nullptr;
+    int best_score = std::numeric_limits<int>::max();
+    int best_offset = std::numeric_limits<int>::max();
+
+    // score a candidate, returns false once no further candidate can win
+    auto consider = [&](const int key, void *candidate) {
+        // candidates are visited in order of increasing distance, and the
+        // score is never lower than the distance
+        const int distance = std::abs(key - center);
+        if (distance > best_score)
+            return false;
+
+        if (candidate == from)
+            return true;
+
+        const Box &other = entries.at(candidate).box;
+
+        // an item sharing the center is only in the direction if it reaches
+        // further along it
+        if (distance == 0) {
+            const bool beyond = [&]() {
+                switch (direction) {
+                case Direction::Up:
+                    return other.y < box.y;
+                case Direction::Down:
+                    return other.y + other.height > box.y + box.height;
+                case Direction::Left:
+                    return other.x < box.x;
+                case Direction::Right:
+                    return other.x + other.width > box.x + box.width;
+                }
+                return false;
+            }();
+            if (!beyond)
+                return true;
+        }
+        const int other_start = horizontal ? other.y : other.x;
+        const int other_end =
+            horizontal ? other.y + other.height : other.x + other.width;
+
+        // gap between the perpendicular spans, zero if they overlap
+        const int gap = std::max(
+            0, std::max(start, other_start) - std::min(end, other_end));
+
+        // offset between the perpendicular centers breaks ties
+        const int offset =
+            std::abs((start + end) / 2 - (other_start + other_end) / 2);
+
+        // prefer items that overlap on the perpendicular axis
+        const int score = distance + 2 * gap;
+        if (score < best_score ||
+            (score == best_score && offset < best_offset)) {
+            target = candidate;
+            best_score = score;
+            best_offset = offset;
+        }
+
+        return true;
+    };
+
+    // walk outwards from the center of the item, starting with the items
+    // that share it
+    const std::multimap<int, void *> &axis = horizontal ? by_x : by_y;
+    switch (direction) {
+    case Direction::Down:
+    case Direction::Right:
+        for (auto curr = axis.lower_bound(center); curr != axis.end(); ++curr)
+            if (!consider(curr->first, curr->second))
+                break;
+        break;
+    case Direction::Up:
+    case Direction::Left:
+        for (auto curr = std::make_reverse_iterator(axis.upper_bound(center));
+             curr != axis.rend(); ++curr)
+            if (!consider(curr->first, curr->second))
+                break;
+        break;
+    }
+
+    // this will be null if an item is not found in the specified direction
+    return target;
+}
@@ -3,6 +3,7 @@
 void Toplevel::map_notify(wl_listener *listener, [[maybe_unused]] void *data) {
     // on map or display
     Toplevel *toplevel = wl_container_of(listener, toplevel, map);
+    AWM_PROBE(toplevel_map, toplevel);
 
     // xdg toplevel
     if (const wlr_xdg_toplevel *xdg_toplevel = toplevel->xdg_toplevel) {
@@ -10,11 +11,7 @@ void Toplevel::map_notify(wl_listener *listener, [[maybe_unused]] void *data) {
         // get the focused output
         if (Output *output = toplevel->server->focused_output()) {
             // set the fractional scale for this surface
-            const float scale = output->wlr_output->scale;
-            wlr_fractional_scale_v1_notify_scale(xdg_toplevel->base->surface,
-                                                 scale);
-            wlr_surface_set_preferred_buffer_scale(xdg_toplevel->base->surface,
-                                                   ceil(scale));
+            toplevel->update_scale(output);
 
             // get usable area of the output
             wlr_box usable_area = output->usable_area;
@@ -58,6 +55,9 @@ void Toplevel::map_notify(wl_listener *listener, [[maybe_unused]] void *data) {
 
             // add toplevel to active workspace and focus it
             output->get_active()->add_toplevel(toplevel, true);
+
+            // add to spatial index
+            toplevel->server->toplevel_index->insert(toplevel);
         }
     }
 #ifdef XWAYLAND
@@ -112,6 +112,8 @@ void Toplevel::map_notify(wl_listener *listener, [[maybe_unused]] void *data) {
                                                   [[maybe_unused]] void *data) {
                 Toplevel *toplevel =
                     wl_container_of(listener, toplevel, xwayland_commit);
+                toplevel->record_commit();
+
                 const wlr_surface_state *state =
                     &toplevel->xwayland_surface->surface->current;
 
@@ -126,6 +128,15 @@ void Toplevel::map_notify(wl_listener *listener, [[maybe_unused]] void *data) {
                     new_box.height != toplevel->saved_geometry.height)
                     memcpy(&toplevel->saved_geometry, &new_box,
                            sizeof(wlr_box));
+
+                // opacity and content type affect fullscreen policies
+                toplevel->update_content_state();
+
+                // client has committed a buffer of the requested size
+                if (toplevel->snapshot &&
+                    new_box.width == toplevel->geometry.width &&
+                    new_box.height == toplevel->geometry.height)
+                    toplevel->destroy_snapshot();
             };
             wl_signal_add(&toplevel->xwayland_surface->surface->events.commit,
                           &toplevel->xwayland_commit);
@@ -138,19 +149,44 @@ void Toplevel::map_notify(wl_listener *listener, [[maybe_unused]] void *data) {
 
             // add to active workspace
             output->get_active()->add_toplevel(toplevel, true);
+
+            // add to spatial index
+            toplevel->geometry = wlr_box{
+                .x = x, .y = y, .width = width, .height = height};
+            toplevel->server->toplevel_index->insert(toplevel);
         }
     }
 #endif
+
+    // apply window rules
+    toplevel->apply_rules();
+
+    // toplevel may cover others
+    toplevel->server->schedule_visibility();
 }
 
 void Toplevel::unmap_notify(wl_listener *listener,
                             [[maybe_unused]] void *data) {
     Toplevel *toplevel = wl_container_of(listener, toplevel, unmap);
+    AWM_PROBE(toplevel_unmap, toplevel);
 
     // deactivate
     if (toplevel == toplevel->server->grabbed_toplevel)
         toplevel->server->cursor->reset_mode();
 
+    // drop any snapshot before the scene tree goes away
+    toplevel->destroy_snapshot();
+
+    // cancel a delayed frame done
+    if (toplevel->frame_done_timer)
+        wl_event_source_timer_update(toplevel->frame_done_timer, 0);
+
+    // remove from spatial index
+    toplevel->server->toplevel_index->remove(toplevel);
+
+    // toplevels below may be uncovered
+    toplevel->server->schedule_visibility();
+
     // remove from workspace
     if (Workspace *workspace = toplevel->server->get_workspace(toplevel))
         workspace->close(toplevel);
@@ -201,22 +237,15 @@ void Toplevel::create_handle() {
     wl_signal_add(&handle->events.request_maximize, &handle_request_maximize);
 
     // handle_request_minimize
-    handle_request_minimize.notify = [](wl_listener *listener,
-                                        [[maybe_unused]] void *data) {
+    handle_request_minimize.notify = [](wl_listener *listener, void *data) {
         Toplevel *toplevel =
             wl_container_of(listener, toplevel, handle_request_minimize);
 
-        // wlr_foreign_toplevel_handle_v1_minimized_event *event =
-        //     static_cast<wlr_foreign_toplevel_handle_v1_minimized_event
-        //     *>(data);
-        //
-        //  FIXME: since awm doesn't support minimization, just update the
-        //  toplevel
-
-        notify_send(
-            "Minimizing foreign toplevels is not supported, expect issues");
-        wlr_scene_node_lower_to_bottom(&toplevel->scene_tree->node);
+        const auto *event =
+            static_cast<wlr_foreign_toplevel_handle_v1_minimized_event *>(data);
 
+        // minimized toplevels are lowered and suspended
+        toplevel->set_minimized(event->minimized);
         toplevel->update_foreign_toplevel();
     };
     wl_signal_add(&handle->events.request_minimize, &handle_request_minimize);
@@ -325,10 +354,35 @@ Toplevel::Toplevel(Server *server, wlr_xdg_toplevel *xdg_toplevel)
     commit.notify = [](wl_listener *listener, [[maybe_unused]] void *data) {
         // on surface state change
         Toplevel *toplevel = wl_container_of(listener, toplevel, commit);
+        TraceSpan span("surface_commit");
+        toplevel->record_commit();
+
+        // time from sending the latest configure to the client applying it
+        if (toplevel->configure_sent_ns &&
+            toplevel->xdg_toplevel->base->current.configure_serial >=
+                toplevel->configure_serial) {
+            AWM_PROBE(configure_ack, toplevel, toplevel->configure_serial);
+            const int64_t now = get_time_nsec();
+            trace_record("configure_ack", toplevel->configure_sent_ns, now);
+            toplevel->server->client_tracker
+                ->get(wl_resource_get_client(
+                    toplevel->xdg_toplevel->base->resource))
+                ->record_configure(now - toplevel->configure_sent_ns);
+            toplevel->configure_sent_ns = 0;
+        }
 
         if (toplevel->xdg_toplevel->base->initial_commit)
             // let client pick dimensions
             wlr_xdg_toplevel_set_size(toplevel->xdg_toplevel, 0, 0);
+
+        // opacity and content type affect fullscreen policies
+        toplevel->update_content_state();
+
+        // client has caught up with the latest configure
+        if (toplevel->snapshot &&
+            toplevel->xdg_toplevel->base->current.configure_serial >=
+                toplevel->snapshot_serial)
+            toplevel->destroy_snapshot();
     };
     wl_signal_add(&xdg_toplevel->base->surface->events.commit, &commit);
 
@@ -397,17 +451,21 @@ Toplevel::Toplevel(Server *server, wlr_xdg_toplevel *xdg_toplevel)
         Toplevel *toplevel =
             wl_container_of(listener, toplevel, request_minimize);
 
-        // move toplevel to the bottom
-        wlr_scene_node_lower_to_bottom(&toplevel->scene_tree->node);
-
-        // focus the next toplevel in the workspace
-        if (Workspace *workspace = toplevel->server->get_workspace(toplevel))
-            workspace->focus_next();
+        // move toplevel to the bottom and suspend it
+        toplevel->set_minimized(true);
     };
     wl_signal_add(&xdg_toplevel->events.request_minimize, &request_minimize);
 }
 
 Toplevel::~Toplevel() {
+    if (snapshot_timer)
+        wl_event_source_remove(snapshot_timer);
+
+    if (frame_done_timer)
+        wl_event_source_remove(frame_done_timer);
+
+    server->toplevel_index->remove(this);
+
 #ifdef XWAYLAND
     if (xwayland_surface) {
         wl_list_remove(&activate.link);
@@ -586,11 +644,20 @@ Toplevel::Toplevel(Server *server, wlr_xwayland_surface *xwayland_surface)
 #endif
 
 // focus keyboard to surface
-void Toplevel::focus() const {
+void Toplevel::focus() {
     // locked
     if (server->locked)
         return;
 
+    // focusing restores a minimized toplevel
+    if (minimized) {
+        minimized = false;
+        if (!hidden)
+            server->toplevel_index->insert(this);
+        update_enabled();
+        server->schedule_visibility();
+    }
+
     wlr_seat *seat = server->seat;
     wlr_surface *prev_surface = seat->keyboard_state.focused_surface;
 
@@ -616,6 +683,8 @@ void Toplevel::focus() const {
         if (prev_surface == surface)
             return;
 
+        AWM_PROBE(focus_change, prev_surface, surface);
+
         // deactivate previous surface
         if (prev_surface) {
             // xdg toplevel
@@ -642,6 +711,7 @@ void Toplevel::focus() const {
 
         // move toplevel node to top of scene tree
         wlr_scene_node_raise_to_top(&scene_tree->node);
+        server->schedule_visibility();
 
         // activate toplevel
         if (xdg_toplevel)
@@ -683,6 +753,15 @@ void Toplevel::begin_interactive(const CursorMode mode, const uint32_t edges) {
         // follow cursor
         cursor->grab_x = cursor->cursor->x - scene_tree->node.x;
         cursor->grab_y = cursor->cursor->y - scene_tree->node.y;
+
+        // cache the source workspace and output of the grab
+        cursor->grab_workspace = server->get_workspace(this);
+        cursor->grab_output = cursor->grab_workspace
+                                  ? cursor->grab_workspace->output
+                                  : server->focused_output();
+        cursor->grab_output_box = cursor->grab_output
+                                      ? cursor->grab_output->layout_geometry
+                                      : wlr_box{};
     } else {
         // don't resize fullscreened windows
         if (xdg_toplevel && xdg_toplevel->current.fullscreen)
@@ -715,9 +794,23 @@ void Toplevel::begin_interactive(const CursorMode mode, const uint32_t edges) {
     }
 }
 
+// notify the toplevel of the scale of the output it is on
+void Toplevel::update_scale(const Output *output) const {
+    // xwayland surfaces do not support fractional scale
+    if (!xdg_toplevel)
+        return;
+
+    const float scale = output->wlr_output->scale;
+    wlr_fractional_scale_v1_notify_scale(xdg_toplevel->base->surface, scale);
+    wlr_surface_set_preferred_buffer_scale(xdg_toplevel->base->surface,
+                                           ceil(scale));
+}
+
 // set the position and size of a toplevel, send a configure
 void Toplevel::set_position_size(const double x, const double y, int width,
                                  int height) {
+    TraceSpan span("configure_send");
+
     // get output at cursor
     const wlr_output *wlr_output = server->focused_output()->wlr_output;
 
@@ -753,7 +846,11 @@ void Toplevel::set_position_size(const double x, const double y, int width,
         wlr_xdg_toplevel_set_size(xdg_toplevel, width / scale, height / scale);
 
         // schedule configure
-        wlr_xdg_surface_schedule_configure(xdg_toplevel->base);
+        configure_serial =
+            wlr_xdg_surface_schedule_configure(xdg_toplevel->base);
+        if (!configure_sent_ns)
+            configure_sent_ns = get_time_nsec();
+        AWM_PROBE(configure_send, this, configure_serial, width, height);
 #ifdef XWAYLAND
     } else {
         // set scene node position
@@ -768,6 +865,16 @@ void Toplevel::set_position_size(const double x, const double y, int width,
                        .y = static_cast<int>(y),
                        .width = width,
                        .height = height};
+
+    // scale the snapshot to the new geometry
+    if (snapshot)
+        update_snapshot();
+
+    // update spatial index
+    server->toplevel_index->update(this);
+
+    // toplevel may cover or uncover others
+    server->schedule_visibility();
 }
 
 void Toplevel::set_position_size(const wlr_box &geometry) {
@@ -801,14 +908,138 @@ wlr_box Toplevel::get_geometry() {
 void Toplevel::set_hidden(const bool hidden) {
     this->hidden = hidden;
 
+    // the snapshot is only useful while the toplevel is visible
+    if (hidden)
+        destroy_snapshot();
+
+    // only visible toplevels are indexed
+    if (hidden || minimized)
+        server->toplevel_index->remove(this);
+    else
+        server->toplevel_index->insert(this);
+
+    // hidden toplevels are suspended
+    server->schedule_visibility();
+
 #ifdef XWAYLAND
+    // xwayland hides its buffer node
+    if (!xdg_toplevel) {
+        wlr_scene_node_set_enabled(&scene_surface->buffer->node, !hidden);
+        return;
+    }
+#endif
+
+    update_enabled();
+}
+
+// minimize the toplevel by disabling it and lowering it to the bottom, or
+// restore it
+void Toplevel::set_minimized(const bool minimized) {
+    if (!minimized) {
+        // restore by focusing
+        if (Workspace *workspace = server->get_workspace(this))
+            workspace->focus_toplevel(this);
+        return;
+    }
+
+    this->minimized = true;
+
+    // minimized toplevels are neither drawn nor indexed
+    destroy_snapshot();
+    server->toplevel_index->remove(this);
+    update_enabled();
+
+    // move toplevel to the bottom
+    if (scene_tree)
+        wlr_scene_node_lower_to_bottom(&scene_tree->node);
+
+    // focus the next toplevel in the workspace
+    Workspace *workspace = server->get_workspace(this);
+    if (workspace && workspace->active_toplevel == this)
+        workspace->focus_next();
+
+    // minimized toplevels are suspended
+    server->schedule_visibility();
+}
+
+// tell the client whether it can be seen, suspended clients may stop
+// rendering and release their buffers
+void Toplevel::set_suspended(const bool suspended) {
+    if (this->suspended == suspended)
+        return;
+
+    this->suspended = suspended;
+
     if (xdg_toplevel)
+        wlr_xdg_toplevel_set_suspended(xdg_toplevel, suspended);
+#ifdef XWAYLAND
+    // closest x11 equivalent is the iconic state
+    else if (xwayland_surface && !xwayland_surface->override_redirect)
+        wlr_xwayland_surface_set_minimized(xwayland_surface, suspended);
 #endif
-        wlr_scene_node_set_enabled(&scene_tree->node, !hidden);
+}
+
+// disable the toplevel while a fullscreen toplevel covers it
+void Toplevel::set_covered(const bool covered) {
+    if (this->covered == covered)
+        return;
+
+    this->covered = covered;
+    update_enabled();
+}
+
+// enable the toplevel in the scene unless it is hidden, minimized or covered
+void Toplevel::update_enabled() {
+    if (!scene_tree)
+        return;
+
 #ifdef XWAYLAND
-    else
-        wlr_scene_node_set_enabled(&scene_surface->buffer->node, !hidden);
+    // xwayland hides its buffer node, the tree is free to toggle
+    if (xwayland_surface) {
+        wlr_scene_node_set_enabled(&scene_tree->node, !minimized && !covered);
+        return;
+    }
 #endif
+
+    wlr_scene_node_set_enabled(&scene_tree->node,
+                               !hidden && !minimized && !covered);
+}
+
+// recompute visibility when the opacity or content type of the toplevel
+// changes, fullscreen toplevels may cover their output or switch its mode
+void Toplevel::update_content_state() {
+    wlr_surface *surface = get_surface();
+    if (!surface)
+        return;
+
+    const bool opaque = this->opaque();
+    const wp_content_type_v1_type content_type =
+        wlr_surface_get_content_type_v1(server->wlr_content_type_manager,
+                                        surface);
+
+    if (opaque == last_opaque && content_type == last_content_type)
+        return;
+
+    last_opaque = opaque;
+    last_content_type = content_type;
+    server->schedule_visibility();
+}
+
+// returns true if the opaque region of the toplevel covers its surface
+bool Toplevel::opaque() const {
+    wlr_surface *surface = get_surface();
+    if (!surface || !surface->mapped)
+        return false;
+
+    pixman_box32_t box{
+        .x1 = 0,
+        .y1 = 0,
+        .x2 = surface->current.width,
+        .y2 = surface->current.height,
+    };
+
+    return pixman_region32_contains_rectangle(&surface->opaque_region, &box) ==
+           PIXMAN_REGION_IN;
 }
 
 // returns true if the toplevel is maximized
@@ -860,6 +1091,9 @@ void Toplevel::set_fullscreen(const bool fullscreen) {
         wlr_scene_node_raise_to_top(&scene_tree->node);
         wlr_scene_node_reparent(&scene_tree->node, server->layers.fullscreen);
 
+        // show the last frame until the client redraws
+        create_snapshot();
+
         // set to top left of output, width and height the size of output
         set_position_size(output_box.x, output_box.y, output_box.width,
                           output_box.height);
@@ -867,6 +1101,9 @@ void Toplevel::set_fullscreen(const bool fullscreen) {
         // move scene tree node to toplevel tree
         wlr_scene_node_reparent(&scene_tree->node, server->layers.floating);
 
+        // show the last frame until the client redraws
+        create_snapshot();
+
         // set back to saved geometry
         set_position_size(saved_geometry.x, saved_geometry.y,
                           saved_geometry.width, saved_geometry.height);
@@ -900,6 +1137,9 @@ void Toplevel::set_maximized(const bool maximized) {
                                            maximized);
 #endif
 
+    // show the last frame until the client redraws
+    create_snapshot();
+
     if (maximized) {
         // save current geometry
         save_geometry();
@@ -954,6 +1194,15 @@ void Toplevel::save_geometry() {
     }
 }
 
+// get the wlr_surface of the toplevel
+wlr_surface *Toplevel::get_surface() const {
+#ifdef XWAYLAND
+    if (xwayland_surface)
+        return xwayland_surface->surface;
+#endif
+    return xdg_toplevel ? xdg_toplevel->base->surface : nullptr;
+}
+
 std::string Toplevel::title() const {
 #ifdef XWAYLAND
     if (xdg_toplevel)
@@ -964,6 +1213,101 @@ std::string Toplevel::title() const {
     return xdg_toplevel->title ? xdg_toplevel->title : "";
 }
 
+std::string Toplevel::app_id() const {
+#ifdef XWAYLAND
+    if (xdg_toplevel)
+        return xdg_toplevel->app_id ? xdg_toplevel->app_id : "";
+    else if (xwayland_surface)
+        return xwayland_surface->class_ ? xwayland_surface->class_ : "";
+#endif
+    return xdg_toplevel->app_id ? xdg_toplevel->app_id : "";
+}
+
+// resolve the window rules that match this toplevel
+void Toplevel::apply_rules() {
+    const std::string id = app_id();
+    const std::string name = title();
+
+    max_fps = 0;
+    max_render_time = 0;
+    tearing.reset();
+    for (const WindowRule &rule : server->config->rules) {
+        if (!rule.matches(id, name))
+            continue;
+
+        if (rule.max_fps)
+            max_fps = rule.max_fps;
+
+        if (rule.max_render_time)
+            max_render_time = rule.max_render_time;
+
+        if (rule.tearing.has_value())
+            tearing = rule.tearing;
+    }
+}
+
+// send frame done to the toplevel after a delay
+void Toplevel::schedule_frame_done(const int64_t delay_ms) {
+    if (!frame_done_timer)
+        frame_done_timer = wl_event_loop_add_timer(
+            wl_display_get_event_loop(server->display),
+            [](void *data) {
+                static_cast<Toplevel *>(data)->send_frame_done();
+                return 0;
+            },
+            this);
+
+    wl_event_source_timer_update(frame_done_timer, static_cast<int>(delay_ms));
+}
+
+// send frame done to every visible surface of the toplevel, throttled by
+// its primary output like the frame done sent after a render
+void Toplevel::send_frame_done() {
+    if (!scene_tree)
+        return;
+
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    frame_done_ns = now.tv_sec * 1000000000ll + now.tv_nsec;
+
+    wlr_scene_node_for_each_buffer(
+        &scene_tree->node,
+        [](wlr_scene_buffer *buffer, [[maybe_unused]] int sx,
+           [[maybe_unused]] int sy, void *data) {
+            // not shown on any output
+            if (!buffer->primary_output)
+                return;
+
+            const wlr_scene_surface *scene_surface =
+                wlr_scene_surface_try_from_buffer(buffer);
+            auto *output =
+                static_cast<Output *>(buffer->primary_output->output->data);
+            if (!scene_surface || !output)
+                return;
+
+            const timespec *when = static_cast<timespec *>(data);
+            output->send_surface_frame_done(
+                buffer, scene_surface->surface, when,
+                when->tv_sec * 1000000000ll + when->tv_nsec);
+        },
+        &now);
+}
+
+// measure the time the client took to commit after its last frame done
+void Toplevel::record_commit() {
+    if (!frame_done_ns)
+        return;
+
+    // idle clients commit late, cap samples so they do not skew the average
+    const int64_t latency =
+        std::min<int64_t>(get_time_nsec() - frame_done_ns, 50000000);
+    frame_done_ns = 0;
+
+    // exponential moving average
+    commit_latency_ns =
+        commit_latency_ns ? (commit_latency_ns * 7 + latency) / 8 : latency;
+}
+
 // tell the toplevel to close
 void Toplevel::close() const {
 #ifdef XWAYLAND
@@ -975,3 +1319,144 @@ void Toplevel::close() const {
         wlr_xwayland_surface_close(xwayland_surface);
 #endif
 }
+
+// capture the buffers currently shown for the toplevel into a snapshot tree,
+// the live surface is hidden until the client catches up with the new size
+void Toplevel::create_snapshot() {
+    // already showing a snapshot or nothing to capture
+    if (snapshot || hidden || !scene_tree ||
+        wl_list_empty(&scene_tree->children))
+        return;
+
+#ifdef XWAYLAND
+    wlr_surface *surface = xdg_toplevel ? xdg_toplevel->base->surface
+                                        : xwayland_surface->surface;
+#else
+    wlr_surface *surface = xdg_toplevel->base->surface;
+#endif
+
+    // cannot capture an unmapped surface
+    if (!surface || !surface->mapped || !surface->current.width ||
+        !surface->current.height)
+        return;
+
+    // window geometry the snapshot is scaled from, relative to the surface.
+    // it excludes client side shadows, like the size the toplevel is given
+#ifdef XWAYLAND
+    snapshot_box = xdg_toplevel ? xdg_toplevel->base->geometry
+                                : wlr_box{.x = 0,
+                                          .y = 0,
+                                          .width = surface->current.width,
+                                          .height = surface->current.height};
+#else
+    snapshot_box = xdg_toplevel->base->geometry;
+#endif
+    if (snapshot_box.width <= 0 || snapshot_box.height <= 0)
+        return;
+
+    // the surface tree is always the first child of the toplevel tree,
+    // popups follow it
+    snapshot_live = wl_container_of(scene_tree->children.next, snapshot_live,
+                                    link);
+
+    // keep the snapshot disabled so it is skipped while being filled, and
+    // below the popups
+    snapshot = wlr_scene_tree_create(scene_tree);
+    wlr_scene_node_set_enabled(&snapshot->node, false);
+    wlr_scene_node_place_above(&snapshot->node, snapshot_live);
+
+    // copy the buffers of the surface and its subsurfaces, popups stay live
+    wlr_scene_node_for_each_buffer(
+        snapshot_live,
+        [](wlr_scene_buffer *buffer, const int sx, const int sy, void *data) {
+            Toplevel *toplevel = static_cast<Toplevel *>(data);
+
+            if (!buffer->buffer)
+                return;
+
+            wlr_scene_buffer *copy =
+                wlr_scene_buffer_create(toplevel->snapshot, buffer->buffer);
+            if (!copy)
+                return;
+
+            wlr_scene_buffer_set_source_box(copy, &buffer->src_box);
+            wlr_scene_buffer_set_transform(copy, buffer->transform);
+            wlr_scene_buffer_set_opacity(copy, buffer->opacity);
+
+            // position relative to the window geometry origin
+            const wlr_box box{
+                .x = sx - toplevel->snapshot_live->x - toplevel->snapshot_box.x,
+                .y = sy - toplevel->snapshot_live->y - toplevel->snapshot_box.y,
+                .width = buffer->dst_width ? buffer->dst_width
+                                           : buffer->buffer->width,
+                .height = buffer->dst_height ? buffer->dst_height
+                                             : buffer->buffer->height,
+            };
+
+            toplevel->snapshot_buffers.push_back({copy, box});
+        },
+        this);
+
+    // swap the live surface for the snapshot
+    wlr_scene_node_set_enabled(snapshot_live, false);
+    wlr_scene_node_set_enabled(&snapshot->node, true);
+
+    // give up on clients that never redraw
+    if (!snapshot_timer)
+        snapshot_timer = wl_event_loop_add_timer(
+            wl_display_get_event_loop(server->display),
+            [](void *data) {
+                static_cast<Toplevel *>(data)->destroy_snapshot();
+                return 0;
+            },
+            this);
+
+    update_snapshot();
+}
+
+// scale the snapshot to the current geometry
+void Toplevel::update_snapshot() {
+    if (!snapshot)
+        return;
+
+    // scale from the captured size to the target size
+    const double scale_x =
+        static_cast<double>(geometry.width) / snapshot_box.width;
+    const double scale_y =
+        static_cast<double>(geometry.height) / snapshot_box.height;
+
+    // follow the live surface
+    wlr_scene_node_set_position(&snapshot->node, snapshot_live->x,
+                                snapshot_live->y);
+
+    for (const auto &[buffer, box] : snapshot_buffers) {
+        const int width = std::round(box.width * scale_x);
+        const int height = std::round(box.height * scale_y);
+
+        // the window geometry origin stays in place
+        wlr_scene_node_set_position(
+            &buffer->node, snapshot_box.x + std::round(box.x * scale_x),
+            snapshot_box.y + std::round(box.y * scale_y));
+        wlr_scene_buffer_set_dest_size(buffer, std::max(width, 1),
+                                       std::max(height, 1));
+    }
+
+    // wait for the latest configure
+    snapshot_serial = configure_serial;
+    wl_event_source_timer_update(snapshot_timer, 200);
+}
+
+// remove the snapshot and show the live surface again
+void Toplevel::destroy_snapshot() {
+    if (!snapshot)
+        return;
+
+    wl_event_source_timer_update(snapshot_timer, 0);
+
+    wlr_scene_node_destroy(&snapshot->node);
+    snapshot = nullptr;
+    snapshot_buffers.clear();
+
+    wlr_scene_node_set_enabled(snapshot_live, !hidden);
+    snapshot_live = nullptr;
+}
@@ -0,0 +1,27 @@
+#include "Server.h"
+
+// add a toplevel to the index or refresh its geometry
+void ToplevelIndex::insert(Toplevel *toplevel) {
+    index.insert(toplevel, to_box(toplevel->geometry));
+}
+
+// refresh the geometry of a toplevel if it is indexed
+void ToplevelIndex::update(Toplevel *toplevel) {
+    index.update(toplevel, to_box(toplevel->geometry));
+}
+
+// remove a toplevel from the index
+void ToplevelIndex::remove(const Toplevel *toplevel) { index.remove(toplevel); }
+
+// returns true if the toplevel is indexed
+bool ToplevelIndex::contains(const Toplevel *toplevel) const {
+    return index.contains(toplevel);
+}
+
+// get the nearest toplevel from the passed one in the specified direction,
+// crossing output boundaries, returns nullptr if no toplevel matches query
+Toplevel *ToplevelIndex::in_direction(const Toplevel *from,
+                                      const wlr_direction direction) const {
+    return static_cast<Toplevel *>(
+        index.in_direction(from, static_cast<Direction>(direction)));
+}
@@ -0,0 +1,88 @@
+#include "Server.h"
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <sys/syscall.h>
+#include <vector>
+using json = nlohmann::json;
+
+// rings of every thread that recorded a span, kept until exit
+static std::mutex rings_mutex;
+static std::vector<std::unique_ptr<TraceRing>> rings;
+
+// the ring of the calling thread, registered on first use
+TraceRing *trace_thread_ring() {
+    thread_local TraceRing *ring = []() {
+        std::lock_guard lock(rings_mutex);
+        return rings
+            .emplace_back(std::make_unique<TraceRing>(
+                static_cast<int>(syscall(SYS_gettid))))
+            .get();
+    }();
+    return ring;
+}
+
+// overwrite the oldest slot, then publish it
+void TraceRing::push(const TraceEvent &event) {
+    const uint64_t index = head.load(std::memory_order_relaxed);
+    events[index % size] = event;
+    head.store(index + 1, std::memory_order_release);
+}
+
+// record a span of the calling thread
+void trace_record(const char *name, const int64_t start_ns,
+                  const int64_t end_ns) {
+    trace_thread_ring()->push({name, start_ns, end_ns - start_ns});
+}
+
+// the spans of all threads as chrome trace event json
+std::string trace_dump() {
+    json events = json::array();
+    const int pid = getpid();
+
+    std::lock_guard lock(rings_mutex);
+    for (const std::unique_ptr<TraceRing> &ring : rings) {
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t first =
+            head > TraceRing::size ? head - TraceRing::size : 0;
+
+        std::vector<TraceEvent> copy;
+        copy.reserve(head - first);
+        for (uint64_t i = first; i != head; ++i)
+            copy.emplace_back(ring->events[i % TraceRing::size]);
+
+        // drop the slots the thread overwrote while copying, and the one it
+        // may be writing now. the fence keeps the copy before the reload
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t end = ring->head.load(std::memory_order_relaxed);
+        const uint64_t overwritten = end + 1 > TraceRing::size + first
+                                         ? end + 1 - TraceRing::size - first
+                                         : 0;
+
+        for (size_t i = std::min<uint64_t>(overwritten, copy.size());
+             i != copy.size(); ++i)
+            events.push_back({
+                {"name", copy[i].name},
+                {"ph", "X"},
+                {"ts", copy[i].start_ns / 1e3},
+                {"dur", copy[i].duration_ns / 1e3},
+                {"pid", pid},
+                {"tid", ring->tid},
+            });
+    }
+
+    return json{
+        {"traceEvents", events},
+        {"displayTimeUnit", "ms"},
+    }
+        .dump();
+}
+
+TraceSpan::TraceSpan(const char *name)
+    : name(name), start_ns(get_time_nsec()), ring(trace_thread_ring()),
+      parent(ring->current.exchange(name, std::memory_order_relaxed)) {}
+
+TraceSpan::~TraceSpan() {
+    ring->current.store(parent, std::memory_order_relaxed);
+    ring->push({name, start_ns, get_time_nsec() - start_ns});
+}
@@ -0,0 +1,183 @@
+#include "Server.h"
+#include <cerrno>
+#include <csignal>
+#include <execinfo.h>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/eventfd.h>
+using json = nlohmann::json;
+
+// backtrace of the main thread, captured by its signal handler
+static void *stall_frames[64];
+static std::atomic<int> stall_frame_count{-1};
+
+Watchdog::Watchdog(Server *server)
+    : server(server),
+      threshold_ns(std::max<int64_t>(server->config->watchdog.threshold, 1) *
+                   1000000),
+      directory(server->config->watchdog.directory),
+      cooldown_ns(std::max<int64_t>(server->config->watchdog.cooldown, 0) *
+                  1000000000),
+      max_reports(server->config->watchdog.max_reports),
+      main_thread(pthread_self()), main_ring(trace_thread_ring()) {
+    // backtrace loads its unwinder on first use, which is not safe in a
+    // signal handler
+    backtrace(stall_frames, 1);
+
+    struct sigaction sa{};
+    sa.sa_handler = []([[maybe_unused]] int sig) {
+        stall_frame_count.store(
+            backtrace(stall_frames, static_cast<int>(std::size(stall_frames))),
+            std::memory_order_release);
+    };
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR2, &sa, nullptr);
+
+    // only wakes the loop, which then sees running cleared
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd != -1)
+        wake_source = wl_event_loop_add_fd(
+            wl_display_get_event_loop(server->display), wake_fd,
+            WL_EVENT_READABLE,
+            [](const int fd, [[maybe_unused]] uint32_t mask,
+               [[maybe_unused]] void *data) {
+                uint64_t count;
+                while (read(fd, &count, sizeof(count)) > 0)
+                    ;
+                return 0;
+            },
+            nullptr);
+
+    thread = std::thread([this]() { watch(); });
+}
+
+Watchdog::~Watchdog() {
+    stop();
+    if (thread.joinable())
+        thread.join();
+
+    if (wake_source)
+        wl_event_source_remove(wake_source);
+    if (wake_fd != -1)
+        close(wake_fd);
+}
+
+// run the event loop, marking when each dispatch starts and ends
+void Watchdog::run() {
+    wl_event_loop *loop = wl_display_get_event_loop(server->display);
+    pollfd fd{.fd = wl_event_loop_get_fd(loop), .events = POLLIN, .revents = 0};
+
+    while (running) {
+        // idle callbacks and flushing count as a dispatch
+        ++dispatches;
+        busy_since_ns = get_time_nsec();
+        wl_event_loop_dispatch_idle(loop);
+        wl_display_flush_clients(server->display);
+        busy_since_ns = 0;
+
+        if (poll(&fd, 1, -1) == -1 && errno != EINTR) {
+            wlr_log(WLR_ERROR, "failed to poll the event loop");
+            break;
+        }
+
+        ++dispatches;
+        busy_since_ns = get_time_nsec();
+        wl_event_loop_dispatch(loop, 0);
+        busy_since_ns = 0;
+    }
+}
+
+// leave the event loop, safe to call from any thread or a signal handler
+void Watchdog::stop() {
+    running = false;
+
+    // a failed write leaves a full eventfd, which wakes the loop anyway
+    const uint64_t one = 1;
+    if (wake_fd != -1) {
+        [[maybe_unused]] const ssize_t written =
+            write(wake_fd, &one, sizeof(one));
+    }
+}
+
+// check the heartbeat a few times per threshold, handling each stalled
+// dispatch once
+void Watchdog::watch() {
+    const auto interval = std::chrono::nanoseconds(
+        std::max<int64_t>(threshold_ns / 4, 5000000));
+    uint64_t reported = 0;
+    int64_t reports = 0, last_report_ns = 0;
+    uint64_t suppressed = 0;
+
+    while (running) {
+        std::this_thread::sleep_for(interval);
+
+        const int64_t busy_since = busy_since_ns;
+        const uint64_t dispatch = dispatches;
+        if (!busy_since || dispatch == reported)
+            continue;
+
+        const int64_t stalled_ns = get_time_nsec() - busy_since;
+        if (stalled_ns < threshold_ns)
+            continue;
+
+        reported = dispatch;
+
+        // modesets and xwayland startup stall routinely, only log those
+        // past the rate limit or cap
+        const int64_t now = get_time_nsec();
+        if (reports >= max_reports ||
+            (last_report_ns && now - last_report_ns < cooldown_ns)) {
+            ++suppressed;
+            wlr_log(WLR_INFO, "event loop stalled for %.1fms",
+                    stalled_ns / 1e6);
+            continue;
+        }
+
+        report(stalled_ns, suppressed);
+        ++reports;
+        last_report_ns = now;
+        suppressed = 0;
+    }
+}
+
+// write the open span, a backtrace of the main thread and the trace rings
+void Watchdog::report(const int64_t stalled_ns,
+                      const uint64_t suppressed) const {
+    json j = {
+        {"stalled_ms", stalled_ns / 1e6},
+        {"threshold_ms", threshold_ns / 1e6},
+        {"suppressed_since_last_report", suppressed},
+    };
+
+    const char *span = main_ring->current.load(std::memory_order_relaxed);
+    j["span"] = span ? span : "";
+
+    // interrupt the main thread where it is stuck
+    stall_frame_count.store(-1, std::memory_order_relaxed);
+    pthread_kill(main_thread, SIGUSR2);
+    const int64_t deadline = get_time_nsec() + 100000000;
+    while (stall_frame_count.load(std::memory_order_acquire) < 0 &&
+           get_time_nsec() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    j["backtrace"] = json::array();
+    if (const int count = stall_frame_count.load(); count > 0) {
+        char **symbols = backtrace_symbols(stall_frames, count);
+        for (int i = 0; symbols && i != count; ++i)
+            j["backtrace"].emplace_back(symbols[i]);
+        free(symbols);
+    }
+
+    j["trace"] = json::parse(trace_dump(), nullptr, false);
+
+    const std::string path =
+        string_format("%s/awm-stall-%d-%ld.json", directory.c_str(), getpid(),
+                      get_time_nsec() / 1000000);
+    std::ofstream file(path);
+    file << j.dump(4) << std::endl;
+
+    wlr_log(WLR_ERROR, "event loop stalled for %.1fms in `%s`, wrote `%s`",
+            stalled_ns / 1e6, span ? span : "unknown", path.c_str());
+}
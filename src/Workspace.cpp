@@ -1,5 +1,4 @@
 #include "Server.h"
-#include <climits>
 
 Workspace::Workspace(Output *output, const uint32_t num)
     : num(num), output(output) {
@@ -69,6 +68,21 @@ bool Workspace::contains(const Toplevel *toplevel) const {
     return false;
 }
 
+// get the topmost visible fullscreen toplevel of the workspace, if any
+Toplevel *Workspace::fullscreen_toplevel() const {
+    // walk the fullscreen layer from top to bottom
+    wlr_scene_node *node;
+    wl_list_for_each_reverse(node, &output->server->layers.fullscreen->children,
+                             link) {
+        Toplevel *toplevel = static_cast<Toplevel *>(node->data);
+        if (toplevel && !toplevel->hidden && !toplevel->minimized &&
+            toplevel->fullscreen() && contains(toplevel))
+            return toplevel;
+    }
+
+    return nullptr;
+}
+
 // move a toplevel to another workspace, returns true on success
 // false on no movement or failure
 bool Workspace::move_to(Toplevel *toplevel, Workspace *workspace) {
@@ -110,82 +124,52 @@ void Workspace::set_hidden(const bool hidden) const {
         toplevel->set_hidden(hidden);
 }
 
-// swap the active toplevel geometry with other toplevel geometry
-void Workspace::swap(Toplevel *other) const {
+// swap the active toplevel geometry with other toplevel geometry, toplevels
+// on different outputs also swap workspaces
+void Workspace::swap(Toplevel *other) {
+    Toplevel *active = active_toplevel;
+
     // get the geometry of both toplevels
-    const wlr_box active = active_toplevel->get_geometry();
-    const wlr_box swapped = other->get_geometry();
+    const wlr_box active_box = active->geometry;
+    const wlr_box other_box = other->geometry;
+
+    // move each toplevel into the workspace of the other
+    Workspace *workspace = output->server->get_workspace(other);
+    if (workspace && workspace != this) {
+        wl_list_remove(&active->link);
+        wl_list_remove(&other->link);
+        wl_list_insert(&workspace->toplevels, &active->link);
+        wl_list_insert(&toplevels, &other->link);
+
+        // update active toplevels
+        if (workspace->active_toplevel == other)
+            workspace->active_toplevel = active;
+        active_toplevel = other;
+
+        // notify both toplevels of their new scale
+        active->update_scale(workspace->output);
+        other->update_scale(output);
+    }
 
     // swap the geometry
-    active_toplevel->set_position_size(swapped);
-    other->set_position_size(active);
+    active->set_position_size(other_box);
+    other->set_position_size(active_box);
+
+    // keep focus on the toplevel that was active
+    if (workspace && workspace != this)
+        output->server->focus_toplevel(active);
 }
 
-// get the toplevel relative to the active one in the specified direction
+// get the toplevel relative to the active one in the specified direction,
+// looking at the visible toplevels of every output
 // returns nullptr if no toplevel matches query
 Toplevel *Workspace::in_direction(const wlr_direction direction) const {
-    // no other toplevel to focus
-    if (wl_list_length(&toplevels) < 2)
+    // no toplevel to start from
+    if (!active_toplevel)
         return nullptr;
 
-    // get the geometry of the active toplevel
-    const wlr_box active_geometry = active_toplevel->get_geometry();
-
-    // define a target
-    Toplevel *curr, *tmp;
-    double min_distance = std::numeric_limits<double>::max();
-    double other = std::numeric_limits<double>::max();
-    Toplevel *target = nullptr;
-
-    // find the smallest positive distance, absolute axis
-    auto validate = [&](const double distance, const double axis) {
-        // note the greater or equals is needed for tiled windows since they
-        // are placed perfectly on the same axis
-        if (distance > 0 && distance <= min_distance && axis < other) {
-            target = curr;
-            min_distance = distance;
-            other = axis;
-        }
-    };
-
-    // get the non-negative displacement for each direction,
-    // - find the smallest distance
-    // - find the smallest absolute difference in the other axis
-    switch (direction) {
-    case WLR_DIRECTION_UP:
-        wl_list_for_each_safe(curr, tmp, &toplevels, link) {
-            const wlr_box curr_geometry = curr->get_geometry();
-            validate(active_geometry.y - curr_geometry.y,
-                     std::abs(active_geometry.x - curr_geometry.x));
-        }
-        break;
-    case WLR_DIRECTION_DOWN:
-        wl_list_for_each_safe(curr, tmp, &toplevels, link) {
-            const wlr_box curr_geometry = curr->get_geometry();
-            validate(curr_geometry.y - active_geometry.y,
-                     std::abs(active_geometry.x - curr_geometry.x));
-        }
-        break;
-    case WLR_DIRECTION_LEFT:
-        wl_list_for_each_safe(curr, tmp, &toplevels, link) {
-            const wlr_box curr_geometry = curr->get_geometry();
-            validate(active_geometry.x - curr_geometry.x,
-                     std::abs(active_geometry.y - curr_geometry.y));
-        }
-        break;
-    case WLR_DIRECTION_RIGHT:
-        wl_list_for_each_safe(curr, tmp, &toplevels, link) {
-            const wlr_box curr_geometry = curr->get_geometry();
-            validate(curr_geometry.x - active_geometry.x,
-                     std::abs(active_geometry.y - curr_geometry.y));
-        }
-        break;
-    default:
-        break;
-    }
-
-    // this will be null if a toplevel is not found in the specified direction
-    return target;
+    return output->server->toplevel_index->in_direction(active_toplevel,
+                                                         direction);
 }
 
 // focus the workspace
@@ -221,36 +205,32 @@ void Workspace::focus_toplevel(Toplevel *toplevel) {
 // focus the toplevel following the active one, looping around to the start
 void Workspace::focus_next() {
     // no movement
-    if (wl_list_length(&toplevels) < 2)
+    if (!active_toplevel)
         return;
 
-    // focus next, wrapping around if at end
-    wl_list *next = active_toplevel->link.next;
-    if (next == &toplevels)
-        next = toplevels.next;
-
-    Toplevel *next_toplevel = wl_container_of(next, next_toplevel, link);
-    focus_toplevel(next_toplevel);
+    if (wl_list *next = focus_step(&toplevels, &active_toplevel->link, true)) {
+        Toplevel *next_toplevel = wl_container_of(next, next_toplevel, link);
+        focus_toplevel(next_toplevel);
+    }
 }
 
 // focus the toplevel preceding the active one, looping around to the end
 void Workspace::focus_prev() {
     // no movement
-    if (wl_list_length(&toplevels) < 2)
+    if (!active_toplevel)
         return;
 
-    // focus prev, wrapping around if at start
-    wl_list *prev = active_toplevel->link.prev;
-    if (prev == &toplevels)
-        prev = toplevels.prev;
-
-    Toplevel *prev_toplevel = wl_container_of(prev, prev_toplevel, link);
-    focus_toplevel(prev_toplevel);
+    if (wl_list *prev = focus_step(&toplevels, &active_toplevel->link, false)) {
+        Toplevel *prev_toplevel = wl_container_of(prev, prev_toplevel, link);
+        focus_toplevel(prev_toplevel);
+    }
 }
 
 // auto-tile the toplevels of a workspace, not currently reversible or
 // any kind of special state
 void Workspace::tile() {
+    TraceSpan span("tile");
+
     // no toplevels to tile
     if (wl_list_empty(&toplevels))
         return;
@@ -276,30 +256,23 @@ void Workspace::tile() {
     if (!toplevel_count)
         return;
 
-    // calculate rows and cols from toplevel count
-    int rows = std::round(std::sqrt(toplevel_count));
-    int cols = (toplevel_count + rows - 1) / rows;
-
-    // width and height is just the fraction of the output binds
-    int width = box.width / cols;
-    int height = box.height / rows;
+    // grid cells in layout coordinates
+    Box area = to_box(box);
+    area.x += output->layout_geometry.x;
+    area.y += output->layout_geometry.y;
+    const std::vector<Box> cells =
+        tile_grid(area, static_cast<size_t>(toplevel_count));
 
     // loop through each toplevel
-    int i = 0;
+    size_t i = 0;
     wl_list_for_each_safe(toplevel, tmp, &toplevels, link) {
         // skip fullscreened toplevel
         if (std::find(fullscreened.begin(), fullscreened.end(), toplevel) !=
             fullscreened.end())
             continue;
 
-        // calculate toplevel geometry
-        int row = i / cols;
-        int col = i % cols;
-        int x = output->layout_geometry.x + box.x + (col * width);
-        int y = output->layout_geometry.y + box.y + (row * height);
-
         // set toplevel geometry
-        toplevel->set_position_size(x, y, width, height);
-        ++i;
+        const Box &cell = cells[i++];
+        toplevel->set_position_size(cell.x, cell.y, cell.width, cell.height);
     }
 }
@@ -1,20 +1,52 @@
 #include "Server.h"
+#include <getopt.h>
 #include <wordexp.h>
 
 Server *Server::instance = nullptr;
 
 int main(const int argc, char *argv[]) {
-    // start logger
-    wlr_log_init(WLR_DEBUG, nullptr);
-
     // startup and config
-    std::string startup_cmd, config_path;
+    std::string startup_cmd, config_path, ipc_socket;
     const std::string usage =
-        "Usage: %s [-s startup command] [-c config file path]\n";
+        "Usage: %s [-s startup command] [-c config file path]\n"
+        "          [-S ipc socket path] [-b] [-n outputs] [-m WxH@Hz]\n"
+        "          [--virtual-clock] [--record file] [--replay file]\n"
+        "          [--replay-speed factor] [-l silent|error|info|debug]\n";
+
+    // headless benchmark mode
+    bool bench = false, virtual_clock = false;
+    int bench_outputs = 1;
+    int32_t bench_width = 1920, bench_height = 1080;
+    double bench_refresh = 60.0;
+
+    // input recording and replay
+    std::string record_path, replay_path;
+    double replay_speed = 1.0;
+
+    // log level, the config level applies if none is given
+    wlr_log_importance log_level = WLR_INFO;
+    bool log_level_set = false;
+
+    const option long_options[] = {
+        {"startup", required_argument, nullptr, 's'},
+        {"config", required_argument, nullptr, 'c'},
+        {"socket", required_argument, nullptr, 'S'},
+        {"bench", no_argument, nullptr, 'b'},
+        {"outputs", required_argument, nullptr, 'n'},
+        {"mode", required_argument, nullptr, 'm'},
+        {"virtual-clock", no_argument, nullptr, 'v'},
+        {"record", required_argument, nullptr, 'r'},
+        {"replay", required_argument, nullptr, 'p'},
+        {"replay-speed", required_argument, nullptr, 'x'},
+        {"log-level", required_argument, nullptr, 'l'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
 
     // parse command line and set values if provided
     int c;
-    while ((c = getopt(argc, argv, "s:c:h")) != -1) {
+    while ((c = getopt_long(argc, argv, "s:c:S:bn:m:l:h", long_options,
+                            nullptr)) != -1) {
         switch (c) {
         case 's':
             startup_cmd = optarg;
@@ -22,6 +54,47 @@ int main(const int argc, char *argv[]) {
         case 'c':
             config_path = optarg;
             break;
+        case 'S':
+            ipc_socket = optarg;
+            break;
+        case 'b':
+            bench = true;
+            break;
+        case 'n':
+            bench_outputs = std::max(atoi(optarg), 1);
+            break;
+        case 'm':
+            // refresh rate is optional
+            if (sscanf(optarg, "%dx%d@%lf", &bench_width, &bench_height,
+                       &bench_refresh) < 2 ||
+                bench_width <= 0 || bench_height <= 0 || bench_refresh <= 0) {
+                printf(usage.c_str(), argv[0]);
+                return 1;
+            }
+            break;
+        case 'v':
+            virtual_clock = true;
+            break;
+        case 'r':
+            record_path = optarg;
+            break;
+        case 'p':
+            replay_path = optarg;
+            break;
+        case 'l':
+            if (!parse_log_level(optarg, &log_level)) {
+                printf(usage.c_str(), argv[0]);
+                return 1;
+            }
+            log_level_set = true;
+            break;
+        case 'x':
+            replay_speed = atof(optarg);
+            if (replay_speed <= 0) {
+                printf(usage.c_str(), argv[0]);
+                return 1;
+            }
+            break;
         default:
             printf(usage.c_str(), argv[0]);
             return 0;
@@ -32,7 +105,11 @@ int main(const int argc, char *argv[]) {
         return 0;
     }
 
-    if (config_path.empty()) {
+    // start logger
+    LogSink *log_sink = new LogSink(log_level);
+
+    // benchmarks only use the config they are given
+    if (config_path.empty() && !bench) {
         wordexp_t p = {.we_wordc = 0, .we_wordv = nullptr, .we_offs = 0};
 
         // no command line path passed, find in default paths
@@ -75,15 +152,67 @@ int main(const int argc, char *argv[]) {
     } else {
         wlr_log(WLR_ERROR, "Config file '%s' does not exist",
                 config_path.c_str());
+        delete log_sink;
         return 1;
     }
 
+    // log level and destination from the config
+    if (!log_level_set && !config->log.level.empty()) {
+        if (parse_log_level(config->log.level, &log_level))
+            log_sink->set_level(log_level);
+        else
+            wlr_log(WLR_ERROR, "unknown log level `%s`",
+                    config->log.level.c_str());
+    }
+    if (!config->log.file.empty())
+        log_sink->open(config->log.file);
+
     // add startup command
     if (!startup_cmd.empty())
         config->startup_commands.push_back(startup_cmd);
 
+    // instance specific IPC socket
+    if (!ipc_socket.empty())
+        config->ipc_socket = ipc_socket;
+
+    config->input.record = record_path;
+    config->input.replay = replay_path;
+    config->input.speed = replay_speed;
+
+    if (bench) {
+        config->bench.enabled = true;
+        config->bench.outputs = bench_outputs;
+        config->bench.width = bench_width;
+        config->bench.height = bench_height;
+        config->bench.refresh = bench_refresh;
+        config->bench.virtual_clock = virtual_clock;
+
+        // software rendering so any machine gives comparable numbers
+        config->renderer = "pixman";
+
+        // keep parallel instances apart
+        if (ipc_socket.empty())
+            config->ipc_socket =
+                "/tmp/awm-bench-" + std::to_string(getpid()) + ".sock";
+
+        // headless outputs side by side at the requested mode
+        for (const OutputConfig *oc : config->outputs)
+            delete oc;
+        config->outputs.clear();
+        for (int i = 0; i != bench_outputs; ++i) {
+            auto *oc = new OutputConfig();
+            oc->name = "HEADLESS-" + std::to_string(i + 1);
+            oc->width = bench_width;
+            oc->height = bench_height;
+            oc->refresh = bench_refresh;
+            oc->x = static_cast<double>(i) * bench_width;
+            config->outputs.emplace_back(oc);
+        }
+    }
+
     // start server
     Server *server = Server::get(config);
     delete server;
     delete config;
+    delete log_sink;
 }